@@ -13,22 +13,44 @@ namespace libpak
   {
 
     /**
-     * Perform alicia checksum on a buffer.
+     * Perform alicia checksum on a buffer. The checksum is a sum of the bytes
+     * sign-extended from char, wrapped to 32 bits. Uses the widest SIMD
+     * implementation supported by the CPU, chosen at runtime.
      * @param buffer Buffer
-     * @param length Length
+     * @param length Length, may be zero.
      * @return Checksum
      */
-    int32_t alicia_checksum(const char* buffer, uint64_t length)
+    int32_t alicia_checksum(const char* buffer, uint64_t length);
+
+    /**
+     * Perform alicia checksum on a buffer, one byte at a time.
+     * Reference implementation for the vectorized alicia_checksum.
+     * @param buffer Buffer
+     * @param length Length, may be zero.
+     * @return Checksum
+     */
+    int32_t alicia_checksum_scalar(const char* buffer, uint64_t length);
+
+    /**
+     * Represents CRC and alicia checksum of a buffer.
+     */
+    struct digest
     {
-      int32_t result = 0;
-      do
-      {
-        result += *buffer;
-        buffer++;
-        length--;
-      } while (length != 0);
-      return result;
-    }
+      //! zlib-compatible CRC32.
+      uint32_t crc{};
+      //! Alicia checksum.
+      int32_t checksum{};
+    };
+
+    /**
+     * Perform zlib-compatible CRC32 and alicia checksum on a buffer in a single pass.
+     * Uses carry-less multiplication folding where the CPU supports it, otherwise
+     * computes both over cache-sized blocks so every byte is fetched from memory once.
+     * @param buffer Buffer
+     * @param length Length, may be zero.
+     * @return Digest
+     */
+    digest crc32_checksum(const char* buffer, uint64_t length);
 
   } // namespace alg
 } // namespace libpak
@@ -0,0 +1,101 @@
+#ifndef LIBPAK_BUILDER_HPP
+#define LIBPAK_BUILDER_HPP
+
+#include "codec.hpp"
+#include "compression.hpp"
+#include "definitions.hpp"
+#include "scratch.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace libpak
+{
+
+  /**
+   * Produces the decompressed data of an asset on demand.
+   * Called at most once, possibly from a worker thread.
+   */
+  using data_producer = std::function<std::vector<std::byte>()>;
+
+  /**
+   * Streaming resource writer. Assets are added with producers of their data,
+   * which are invoked only while the resource is being written. The data is
+   * written sequentially and released right after, only the header table is
+   * kept in memory, so building a resource does not require memory
+   * proportional to its size.
+   */
+  class builder
+  {
+  public:
+    /**
+     * Constructs the builder of the resource at the path.
+     * @param path Path of the resource.
+     */
+    explicit builder(std::string path) : resource_path(std::move(path)) {}
+
+    /**
+     * Adds an asset with data provided by the producer.
+     * @param path       Path of the asset.
+     * @param producer   Producer of the asset's decompressed data.
+     * @param compressed Whether to store the data compressed.
+     * @throws std::runtime_error when the path is too long.
+     */
+    void add(std::u16string_view path, data_producer producer, bool compressed = true);
+
+    /**
+     * Adds an asset with data read from the file when written.
+     * @param path       Path of the asset.
+     * @param file_path  Path of the file with the asset's data.
+     * @param compressed Whether to store the data compressed.
+     * @throws std::runtime_error when the path is too long.
+     */
+    void add_file(std::u16string_view path, std::string file_path, bool compressed = true);
+
+    /**
+     * Writes the resource. Producers are invoked on worker threads, with at
+     * most a few assets in flight per worker, and the data is written in the
+     * order the assets were added. The header table and the headers of the
+     * resource are written last.
+     * @throws std::runtime_error
+     */
+    void write();
+
+    /**
+     * @return Count of added assets.
+     */
+    [[nodiscard]] size_t size() const noexcept { return this->headers.size(); }
+
+  public:
+    //! Count of worker threads, zero uses the hardware concurrency.
+    unsigned worker_count = 0;
+    //! Codec compressing the asset data.
+    codec_backend compression_backend = default_codec_backend();
+    //! Policy deciding how the compressed assets are compressed, the highest level when not set.
+    std::shared_ptr<const libpak::compression_policy> compression_policy;
+    //! Report of the compression of the last write.
+    struct compression_report compression_report;
+    //! Pool of the compression buffers.
+    scratch_pool scratch;
+
+    struct pak_header pak_header;
+    struct content_header content_header;
+    struct data_header data_header;
+
+  private:
+    std::string resource_path;
+
+    //! Header table, in the order the assets were added.
+    std::vector<asset_header> headers;
+    //! Data producers, released once invoked.
+    std::vector<data_producer> producers;
+  };
+
+} // namespace libpak
+
+#endif // LIBPAK_BUILDER_HPP
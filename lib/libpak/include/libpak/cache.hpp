@@ -0,0 +1,108 @@
+#ifndef LIBPAK_CACHE_HPP
+#define LIBPAK_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace libpak
+{
+
+  struct asset_data;
+
+  //! Shared, immutable asset payload.
+  using shared_payload = std::shared_ptr<const asset_data>;
+
+  /**
+   * Payload cache statistics.
+   */
+  struct cache_stats
+  {
+    uint64_t hits{};
+    uint64_t misses{};
+    uint64_t evictions{};
+    //! Count of cached payloads.
+    uint64_t entries{};
+    //! Size of cached payloads in bytes.
+    uint64_t size{};
+    //! Memory budget in bytes.
+    uint64_t budget{};
+  };
+
+  /**
+   * Least-recently-used cache of asset payloads bounded by a memory budget.
+   * The cache is thread-safe.
+   */
+  class payload_cache
+  {
+  public:
+    //! Default memory budget, 256 MiB.
+    static constexpr uint64_t DEFAULT_BUDGET = 256ull * 1024 * 1024;
+
+    /**
+     * Default constructor.
+     * @param budget Memory budget in bytes.
+     */
+    explicit payload_cache(uint64_t budget = DEFAULT_BUDGET) noexcept : budget(budget) {}
+
+    /**
+     * Finds the payload and marks it as most recently used.
+     * @param key Payload key.
+     * @return Payload, or nullptr if it is not cached.
+     */
+    shared_payload find(uint64_t key);
+
+    /**
+     * Inserts the payload, evicting least recently used payloads until the cache fits
+     * into the budget. Payloads larger than the budget are not cached.
+     * @param key     Payload key.
+     * @param payload Payload.
+     */
+    void insert(uint64_t key, shared_payload payload);
+
+    /**
+     * Sets the memory budget, evicting payloads that no longer fit.
+     * @param budget Memory budget in bytes.
+     */
+    void set_budget(uint64_t budget);
+
+    /**
+     * Drops all cached payloads. Statistics are kept.
+     */
+    void clear() noexcept;
+
+    /**
+     * @return Cache statistics.
+     */
+    [[nodiscard]] cache_stats stats() const;
+
+  private:
+    /**
+     * Evicts payloads until the cache fits into the budget. Expects the mutex to be held.
+     */
+    void evict();
+
+    struct entry
+    {
+      uint64_t key;
+      shared_payload payload;
+    };
+
+    mutable std::mutex mutex;
+    //! Entries ordered from the most to the least recently used.
+    std::list<entry> entries;
+    std::unordered_map<uint64_t, std::list<entry>::iterator> lookup;
+
+    uint64_t budget;
+    uint64_t size = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+} // namespace libpak
+
+#endif // LIBPAK_CACHE_HPP
@@ -0,0 +1,90 @@
+#ifndef LIBPAK_CODEC_HPP
+#define LIBPAK_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace libpak
+{
+
+  /**
+   * Implementation of the zlib stream compression.
+   */
+  enum class codec_backend
+  {
+    //! zlib's compress2 and uncompress2.
+    zlib,
+    //! libdeflate's whole buffer API, available when built with LIBPAK_WITH_LIBDEFLATE.
+    libdeflate,
+  };
+
+  /**
+   * Compresses and decompresses whole buffers to and from zlib streams.
+   * Every backend produces streams the others, and the game, can consume,
+   * though not necessarily byte-identical ones. Thread-safe.
+   */
+  class codec
+  {
+  public:
+    virtual ~codec() = default;
+
+    /**
+     * @return Name of the codec.
+     */
+    [[nodiscard]] virtual std::string_view name() const noexcept = 0;
+
+    /**
+     * @param size Size of the data.
+     * @throws std::runtime_error
+     * @return Largest possible size of the compressed data.
+     */
+    [[nodiscard]] virtual uint64_t compress_bound(uint64_t size) const = 0;
+
+    /**
+     * Compresses the data to a zlib stream.
+     * @param data   Data.
+     * @param output Output buffer, at least compress_bound large.
+     * @param level  Compression level, from 1 to 9.
+     * @throws std::runtime_error when the data can't be compressed.
+     * @return Size of the compressed data.
+     */
+    virtual uint64_t compress(
+      std::span<const std::byte> data,
+      std::span<std::byte> output,
+      int level) const = 0;
+
+    /**
+     * Decompresses the zlib stream.
+     * @param data   Compressed data.
+     * @param output Output buffer.
+     * @throws std::runtime_error when the data is corrupted or does not fit the output.
+     * @return Size of the decompressed data.
+     */
+    virtual uint64_t decompress(
+      std::span<const std::byte> data,
+      std::span<std::byte> output) const = 0;
+  };
+
+  /**
+   * @param backend Codec backend.
+   * @return True if the backend is built in.
+   */
+  [[nodiscard]] bool is_codec_available(codec_backend backend) noexcept;
+
+  /**
+   * @return The fastest built in backend.
+   */
+  [[nodiscard]] codec_backend default_codec_backend() noexcept;
+
+  /**
+   * @param backend Codec backend.
+   * @throws std::runtime_error when the backend is not built in.
+   * @return Codec of the backend.
+   */
+  [[nodiscard]] const codec& get_codec(codec_backend backend);
+
+} // namespace libpak
+
+#endif // LIBPAK_CODEC_HPP
@@ -0,0 +1,143 @@
+#ifndef LIBPAK_COMPACT_INDEX_HPP
+#define LIBPAK_COMPACT_INDEX_HPP
+
+#include "definitions.hpp"
+#include "path_index.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace libpak
+{
+
+  /**
+   * Compact, index-only representation of the resource's assets.
+   * Paths are stored in a shared string arena and the frequently used header
+   * fields in a structure of arrays. Entries are numbered by their position
+   * in the resource's header table, the full header can be read on demand
+   * through resource::read_asset_headers.
+   */
+  class compact_index
+  {
+  public:
+    //! Asset flags.
+    enum flag : uint8_t
+    {
+      EMBEDDED = 1 << 0,
+      COMPRESSED = 1 << 1,
+      DELETED = 1 << 2,
+      //! Superseded by a later entry of the same path, which find() returns.
+      SHADOWED = 1 << 3,
+    };
+
+    /**
+     * Reserves memory for the entries.
+     * @param count Count of entries.
+     */
+    void reserve(uint32_t count);
+
+    /**
+     * Appends entry for the asset header.
+     * @param header Asset header.
+     */
+    void add(const asset_header& header);
+
+    /**
+     * Builds the path index, call after the last entry was added.
+     * Of duplicate paths the last entry wins, the others are shadowed.
+     */
+    void build();
+
+    /**
+     * Clears the index and releases its memory.
+     */
+    void clear() noexcept;
+
+    /**
+     * @return Count of entries.
+     */
+    [[nodiscard]] uint32_t size() const noexcept { return static_cast<uint32_t>(this->flags.size()); }
+
+    /**
+     * @return Approximate memory used by the index in bytes.
+     */
+    [[nodiscard]] uint64_t memory_usage() const noexcept;
+
+    /**
+     * Finds entry by its UTF-8 path.
+     * @param path Path.
+     * @return Entry, or empty optional if there is no such entry.
+     */
+    [[nodiscard]] std::optional<uint32_t> find(std::string_view path) const;
+
+    /**
+     * Finds entry by its UTF-16 path.
+     * @param path Path.
+     * @return Entry, or empty optional if there is no such entry.
+     */
+    [[nodiscard]] std::optional<uint32_t> find(std::u16string_view path) const;
+
+    //! UTF-16 path of the entry.
+    [[nodiscard]] std::u16string_view path(const uint32_t entry) const noexcept
+    {
+      return std::u16string_view(this->path_arena).substr(
+        this->path_offsets[entry], this->path_lengths[entry]);
+    }
+
+    //! Embedded data offset of the entry.
+    [[nodiscard]] uint32_t embedded_data_offset(const uint32_t entry) const noexcept
+    {
+      return this->embedded_data_offsets[entry];
+    }
+
+    //! Embedded data length of the entry.
+    [[nodiscard]] uint32_t embedded_data_length(const uint32_t entry) const noexcept
+    {
+      return this->embedded_data_lengths[entry];
+    }
+
+    //! Decompressed data length of the entry.
+    [[nodiscard]] uint32_t data_decompressed_length(const uint32_t entry) const noexcept
+    {
+      return this->data_decompressed_lengths[entry];
+    }
+
+    //! CRC of the entry's embedded data.
+    [[nodiscard]] uint32_t crc_embedded(const uint32_t entry) const noexcept
+    {
+      return this->crcs_embedded[entry];
+    }
+
+    //! CRC of the entry's decompressed data.
+    [[nodiscard]] uint32_t crc_decompressed(const uint32_t entry) const noexcept
+    {
+      return this->crcs_decompressed[entry];
+    }
+
+    //! Whether the entry has the flag set.
+    [[nodiscard]] bool has_flag(const uint32_t entry, const flag flag) const noexcept
+    {
+      return (this->flags[entry] & flag) != 0;
+    }
+
+  private:
+    std::u16string path_arena;
+    std::vector<uint32_t> path_offsets;
+    std::vector<uint16_t> path_lengths;
+
+    std::vector<uint32_t> embedded_data_offsets;
+    std::vector<uint32_t> embedded_data_lengths;
+    std::vector<uint32_t> data_decompressed_lengths;
+    std::vector<uint32_t> crcs_embedded;
+    std::vector<uint32_t> crcs_decompressed;
+    std::vector<uint8_t> flags;
+
+    path_index paths;
+  };
+
+} // namespace libpak
+
+#endif // LIBPAK_COMPACT_INDEX_HPP
@@ -0,0 +1,131 @@
+#ifndef LIBPAK_COMPRESSION_HPP
+#define LIBPAK_COMPRESSION_HPP
+
+#include "codec.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace libpak
+{
+
+  /**
+   * Compression level of the assets matching the rule.
+   */
+  struct compression_rule
+  {
+    //! Extension of the matching assets, lower case without the dot, empty matches any.
+    std::string extension;
+    //! Smallest size of the matching assets.
+    uint64_t min_size = 0;
+    //! Compression level, zero stores the data raw.
+    int level = 9;
+  };
+
+  /**
+   * Decides how the data of the assets marked as compressed is compressed.
+   * The level comes from the rules, and the data is stored raw when a sample
+   * of it does not compress well enough to be worth the CPU time.
+   */
+  class compression_policy
+  {
+  public:
+    /**
+     * @param path Path of the asset.
+     * @param size Size of the asset's data.
+     * @return Compression level of the asset, zero to store it raw.
+     */
+    [[nodiscard]] int level(std::u16string_view path, uint64_t size) const;
+
+    /**
+     * Compresses evenly spaced samples of the data at the sample level.
+     * Data up to the sample size is always considered compressible, the
+     * compressed data is checked instead.
+     * @param data  Data.
+     * @param codec Codec.
+     * @return True if the samples compress to at most the maximal ratio.
+     */
+    [[nodiscard]] bool is_compressible(std::span<const std::byte> data, const codec& codec) const;
+
+    /**
+     * @param size            Size of the data.
+     * @param compressed_size Size of the compressed data.
+     * @return True if the compressed data is small enough to be stored.
+     */
+    [[nodiscard]] bool is_worth_storing(uint64_t size, uint64_t compressed_size) const noexcept
+    {
+      return static_cast<double>(compressed_size) <= static_cast<double>(size) * this->max_ratio;
+    }
+
+  public:
+    //! Level of the assets no rule matches.
+    int default_level = 9;
+    //! Largest ratio of the compressed to the original size worth storing.
+    double max_ratio = 0.9;
+    //! Total size of the samples.
+    uint64_t sample_size = 64 * 1024;
+    //! Count of the samples.
+    uint32_t sample_count = 4;
+    //! Level the samples are compressed at.
+    int sample_level = 1;
+    //! Rules, the last matching rule applies.
+    std::vector<compression_rule> rules;
+  };
+
+  /**
+   * Report of the compression of the written assets, by their extension.
+   */
+  struct compression_report
+  {
+    struct entry
+    {
+      //! Count of the assets.
+      uint64_t assets{};
+      //! Count of the assets marked as compressed, but stored raw.
+      uint64_t stored_raw{};
+      //! Size of the data.
+      uint64_t bytes_in{};
+      //! Size of the written data.
+      uint64_t bytes_out{};
+      //! Time spent sampling and compressing.
+      std::chrono::nanoseconds compression_time{};
+    };
+
+    /**
+     * Accounts the written asset.
+     * @param path             Path of the asset.
+     * @param bytes_in         Size of the data.
+     * @param bytes_out        Size of the written data.
+     * @param stored_raw       Whether the asset was marked as compressed, but stored raw.
+     * @param compression_time Time spent sampling and compressing.
+     */
+    void add(
+      std::u16string_view path,
+      uint64_t bytes_in,
+      uint64_t bytes_out,
+      bool stored_raw,
+      std::chrono::nanoseconds compression_time);
+
+    /**
+     * @return Report formatted as a table, one row per extension and a total.
+     */
+    [[nodiscard]] std::string to_string() const;
+
+    //! Entries by the extension.
+    std::map<std::string, entry> entries;
+  };
+
+  /**
+   * @param path Path of the asset.
+   * @return Extension of the path, lower case without the dot.
+   */
+  [[nodiscard]] std::string extension_of(std::u16string_view path);
+
+} // namespace libpak
+
+#endif // LIBPAK_COMPRESSION_HPP
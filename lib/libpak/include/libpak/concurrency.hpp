@@ -0,0 +1,205 @@
+#ifndef LIBPAK_CONCURRENCY_HPP
+#define LIBPAK_CONCURRENCY_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace libpak
+{
+
+  /**
+   * Blocking multi-producer multi-consumer queue with bounded capacity.
+   * @tparam Item Item type.
+   */
+  template <typename Item>
+  class bounded_queue
+  {
+  public:
+    /**
+     * Default constructor.
+     * @param capacity Maximum count of queued items.
+     */
+    explicit bounded_queue(const size_t capacity) : capacity(capacity == 0 ? 1 : capacity) {}
+
+    /**
+     * Pushes the item, blocking while the queue is full.
+     * @param item Item.
+     * @return False if the queue was closed, otherwise returns true.
+     */
+    bool push(Item item)
+    {
+      std::unique_lock lock(this->mutex);
+      this->not_full.wait(lock, [this] { return this->closed || this->items.size() < this->capacity; });
+      if (this->closed)
+        return false;
+
+      this->items.push_back(std::move(item));
+      this->not_empty.notify_one();
+      return true;
+    }
+
+    /**
+     * Pops the item, blocking while the queue is empty.
+     * @return Item, or empty optional when the queue is closed and drained.
+     */
+    std::optional<Item> pop()
+    {
+      std::unique_lock lock(this->mutex);
+      this->not_empty.wait(lock, [this] { return this->closed || !this->items.empty(); });
+      if (this->items.empty())
+        return std::nullopt;
+
+      Item item = std::move(this->items.front());
+      this->items.pop_front();
+      this->not_full.notify_one();
+      return item;
+    }
+
+    /**
+     * Closes the queue. Pushing fails from now on and popping drains the remaining items.
+     */
+    void close()
+    {
+      std::scoped_lock lock(this->mutex);
+      this->closed = true;
+      this->not_empty.notify_all();
+      this->not_full.notify_all();
+    }
+
+  private:
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<Item> items;
+    const size_t capacity;
+    bool closed = false;
+  };
+
+  /**
+   * @param count Requested worker count, zero for automatic.
+   * @return Count of worker threads to use.
+   */
+  inline unsigned resolve_worker_count(const unsigned count) noexcept
+  {
+    if (count != 0)
+      return count;
+    const unsigned hardware = std::thread::hardware_concurrency();
+    return hardware == 0 ? 1 : hardware;
+  }
+
+  /**
+   * Produces results on worker threads and consumes them on the calling thread
+   * in the order of their indices. At most `window` results are produced ahead
+   * of the consumer, which bounds the memory held by the pipeline.
+   * The first exception thrown by a producer or the consumer stops the pipeline
+   * and is rethrown once all workers have finished.
+   * @tparam Result   Result type.
+   * @param count     Count of results.
+   * @param workers   Count of worker threads.
+   * @param window    Maximum count of results in flight.
+   * @param produce   Producer, `Result(size_t index)`, called concurrently.
+   * @param consume   Consumer, `void(size_t index, Result&& result)`.
+   */
+  template <typename Result, typename Produce, typename Consume>
+  void ordered_pipeline(
+    const size_t count,
+    unsigned workers,
+    size_t window,
+    Produce&& produce,
+    Consume&& consume)
+  {
+    workers = workers == 0 ? 1 : workers;
+    window = window < workers ? workers : window;
+
+    std::mutex mutex;
+    std::condition_variable produced;
+    std::condition_variable consumed;
+    std::vector<std::optional<Result>> slots(window);
+    size_t next_index = 0;
+    size_t consumed_count = 0;
+    std::exception_ptr error;
+
+    const auto fail = [&](std::exception_ptr exception) {
+      std::scoped_lock lock(mutex);
+      if (!error)
+        error = std::move(exception);
+      produced.notify_all();
+      consumed.notify_all();
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (unsigned worker = 0; worker < workers; ++worker)
+    {
+      threads.emplace_back([&] {
+        while (true)
+        {
+          size_t index;
+          {
+            std::unique_lock lock(mutex);
+            consumed.wait(lock, [&] {
+              return error || next_index >= count || next_index < consumed_count + window;
+            });
+            if (error || next_index >= count)
+              return;
+            index = next_index++;
+          }
+
+          try
+          {
+            Result result = produce(index);
+
+            std::scoped_lock lock(mutex);
+            slots[index % window].emplace(std::move(result));
+            produced.notify_all();
+          }
+          catch (...)
+          {
+            fail(std::current_exception());
+            return;
+          }
+        }
+      });
+    }
+
+    for (size_t index = 0; index < count; ++index)
+    {
+      std::optional<Result> result;
+      {
+        std::unique_lock lock(mutex);
+        produced.wait(lock, [&] { return error || slots[index % window].has_value(); });
+        if (error)
+          break;
+        result = std::move(slots[index % window]);
+        slots[index % window].reset();
+        consumed_count++;
+        consumed.notify_all();
+      }
+
+      try
+      {
+        consume(index, std::move(*result));
+      }
+      catch (...)
+      {
+        fail(std::current_exception());
+        break;
+      }
+    }
+
+    for (auto& thread : threads)
+      thread.join();
+
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+} // namespace libpak
+
+#endif // LIBPAK_CONCURRENCY_HPP
@@ -5,15 +5,22 @@
 #ifndef LIBPAK_DEFINITIONS_HPP
 #define LIBPAK_DEFINITIONS_HPP
 
+#include "cache.hpp"
+#include "path_index.hpp"
+
 #include <cstdint>
 #include <cstring>
 #include <memory>
+#include <span>
 #include <vector>
 #include <string>
+#include <string_view>
 
 namespace libpak
 {
 
+class resource;
+
 #pragma pack(push, 1)
 
 static constexpr size_t PAK_CONTENT_SECTOR = 0x7D000;
@@ -49,6 +56,9 @@ struct content_header
   uint32_t assets_count{};
 };
 
+//! Asset headers are laid out right after the content header.
+static constexpr size_t PAK_ASSET_HEADERS_SECTOR = PAK_CONTENT_SECTOR + sizeof(content_header);
+
 /**
  * Represents asset header.
  */
@@ -98,11 +108,122 @@ struct data_header
 };
 
 /**
- * Represents asset data.
+ * Represents asset data. The data is either owned by the buffer, or borrowed
+ * as a view into a region kept alive by the view owner, such as a mapping.
+ * Borrowed data is copied into the buffer only once it is modified. The data
+ * is replaced only through the member functions, which track the modification.
  */
 struct asset_data
 {
+  /**
+   * @return True if the data is borrowed.
+   */
+  [[nodiscard]] bool is_view() const noexcept { return this->view.data() != nullptr; }
+
+  /**
+   * @return Read-only view of the data, borrowed or owned.
+   */
+  [[nodiscard]] std::span<const std::byte> bytes() const noexcept
+  {
+    if (this->is_view())
+      return this->view;
+    return this->buffer;
+  }
+
+  /**
+   * @return Size of the data.
+   */
+  [[nodiscard]] size_t size() const noexcept { return this->bytes().size(); }
+
+  /**
+   * @return True if there is no data.
+   */
+  [[nodiscard]] bool empty() const noexcept { return this->bytes().empty(); }
+
+  /**
+   * @return True if the data was replaced or handed out for modification
+   *         since it was loaded or written.
+   */
+  [[nodiscard]] bool modified() const noexcept { return this->dirty; }
+
+  /**
+   * Borrows the data the source resource holds, which is no modification.
+   * @param data  Data.
+   * @param owner Owner of the data region.
+   */
+  void load(const std::span<const std::byte> data, std::shared_ptr<const void> owner) noexcept
+  {
+    this->buffer.clear();
+    this->view = data;
+    this->view_owner = std::move(owner);
+    this->dirty = false;
+  }
+
+  /**
+   * Borrows the data.
+   * @param data  Data.
+   * @param owner Owner of the data region.
+   */
+  void borrow(const std::span<const std::byte> data, std::shared_ptr<const void> owner) noexcept
+  {
+    this->load(data, std::move(owner));
+    this->dirty = true;
+  }
+
+  /**
+   * Owns the data.
+   * @param data Data.
+   */
+  void own(std::vector<std::byte> data) noexcept
+  {
+    this->buffer = std::move(data);
+    this->view = {};
+    this->view_owner.reset();
+    this->dirty = true;
+  }
+
+  /**
+   * Takes ownership of the data, copying borrowed data into the buffer.
+   * The buffer may be modified until the data is written.
+   * @return Owned buffer for modification.
+   */
+  std::vector<std::byte>& mutable_buffer()
+  {
+    if (this->is_view())
+    {
+      this->buffer.assign(this->view.begin(), this->view.end());
+      this->view = {};
+      this->view_owner.reset();
+    }
+    this->dirty = true;
+    return this->buffer;
+  }
+
+  /**
+   * Releases the data, copying borrowed data. Owned data is moved, so it stays in place.
+   * @return Owned data.
+   */
+  [[nodiscard]] std::vector<std::byte> release()
+  {
+    auto data = std::move(this->mutable_buffer());
+    this->buffer.clear();
+    return data;
+  }
+
+  /**
+   * Marks the data as unmodified, once it is written.
+   */
+  void clean() noexcept { this->dirty = false; }
+
+private:
+  //! Owned data.
   std::vector<std::byte> buffer;
+  //! Borrowed data, valid as long as the view owner is alive.
+  std::span<const std::byte> view;
+  //! Keeps the region of the borrowed data alive.
+  std::shared_ptr<const void> view_owner;
+  //! Whether the data was modified since it was loaded or written.
+  bool dirty = false;
 };
 
 /**
@@ -121,24 +242,63 @@ struct asset
   asset_data data{};
 
   /**
-   * @return String view of the asset path.
+   * Resource the asset was indexed from, if any.
+   */
+  resource* source = nullptr;
+
+  //! Header index of assets which are not stored in a resource yet.
+  static constexpr uint32_t UNINDEXED = UINT32_MAX;
+
+  /**
+   * Index of the asset's header in the resource's header table.
+   */
+  uint32_t header_index = UNINDEXED;
+
+  /**
+   * @return View of the raw UTF-16 asset path.
+   */
+  [[nodiscard]] std::u16string_view path_view() const noexcept {
+    size_t length = 0;
+    while (length < std::size(header.path) && header.path[length] != u'\0')
+      ++length;
+    return {header.path, length};
+  }
+
+  /**
+   * @return UTF-8 asset path.
    */
   [[nodiscard]] std::string path() const {
-    char path[512] {};
-    for (unsigned index = 0, ptr = 0; index < std::size(header.path); ++index) {
-      if (header.path[index] == '\0')
-        break;
-      int const size = wctomb(&path[ptr], header.path[index]);
-      ptr += size;
-    }
-    return {path};
+    return path_index::to_utf8(path_view());
   }
 
+  /**
+   * Loads the asset's payload from the resource it was indexed from on demand.
+   * Payloads are kept in the resource's payload cache, so repeated access is cheap
+   * and memory use stays within the cache budget.
+   * @throws std::runtime_error when the asset has no source resource or the read fails.
+   * @return Payload.
+   */
+  [[nodiscard]] shared_payload payload() const;
+
   /**
    * Mark the asset as patched.
    */
   void markAsPatched() { this->patched = true; }
 
+  /**
+   * @return True if the asset was marked as patched or its data was modified.
+   */
+  [[nodiscard]] bool isPatched() const { return this->patched || this->data.modified(); }
+
+  /**
+   * Clear the patched mark, once the patch is written.
+   */
+  void clearPatched()
+  {
+    this->patched = false;
+    this->data.clean();
+  }
+
 private:
   bool patched = false;
 };
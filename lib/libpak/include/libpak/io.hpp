@@ -0,0 +1,405 @@
+#ifndef LIBPAK_IO_HPP
+#define LIBPAK_IO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace libpak
+{
+
+  /**
+   * Mode of opening a file.
+   */
+  enum class file_mode
+  {
+    //! Open an existing file for reading.
+    read,
+    //! Open an existing file for reading and writing.
+    read_write,
+    //! Create or truncate the file for reading and writing.
+    create,
+  };
+
+  /**
+   * File accessed through positional I/O. The file has no shared cursor,
+   * so it can be read and written from many threads at once.
+   */
+  class file
+  {
+  public:
+    /**
+     * Opens the file at the path.
+     * @param path Path to the file.
+     * @param mode Open mode.
+     * @throws std::runtime_error when the file can't be opened.
+     */
+    explicit file(const std::string& path, file_mode mode = file_mode::read);
+
+    file(const file&) = delete;
+    file& operator=(const file&) = delete;
+
+    /**
+     * Closes the file.
+     */
+    ~file() noexcept;
+
+    /**
+     * Reads buffer from the file at the offset. Thread-safe.
+     * @param buffer Buffer.
+     * @param size   Buffer size.
+     * @param offset Offset.
+     * @return True if the whole buffer was read, otherwise returns false.
+     */
+    bool read_at(std::byte* buffer, uint64_t size, uint64_t offset) const noexcept;
+
+    /**
+     * Reads blob from the file at the offset. Thread-safe.
+     * @tparam Blob  Blob type.
+     * @param blob   Blob.
+     * @param offset Offset.
+     * @return True if reading was successful, otherwise returns false.
+     */
+    template <typename Blob>
+    bool read_at(Blob& blob, const uint64_t offset) const noexcept
+    {
+      return read_at(reinterpret_cast<std::byte*>(&blob), sizeof blob, offset);
+    }
+
+    /**
+     * Writes buffer to the file at the offset. Thread-safe.
+     * @param buffer Buffer.
+     * @param size   Buffer size.
+     * @param offset Offset.
+     * @return True if the whole buffer was written, otherwise returns false.
+     */
+    bool write_at(const std::byte* buffer, uint64_t size, uint64_t offset) const noexcept;
+
+    /**
+     * Writes blob to the file at the offset. Thread-safe.
+     * @tparam Blob  Blob type.
+     * @param blob   Blob.
+     * @param offset Offset.
+     * @return True if writing was successful, otherwise returns false.
+     */
+    template <typename Blob>
+    bool write_at(const Blob& blob, const uint64_t offset) const noexcept
+    {
+      return write_at(reinterpret_cast<const std::byte*>(&blob), sizeof blob, offset);
+    }
+
+    /**
+     * Flushes written data to the storage.
+     * @return True if successful, otherwise returns false.
+     */
+    bool sync() const noexcept;
+
+    /**
+     * @return Size of the file.
+     */
+    [[nodiscard]] uint64_t size() const noexcept;
+
+    /**
+     * @return Native file descriptor.
+     */
+    [[nodiscard]] int descriptor() const noexcept { return this->file_descriptor; }
+
+  private:
+    int file_descriptor = -1;
+  };
+
+  /**
+   * Read-only memory mapping of a whole file.
+   */
+  class mapped_file
+  {
+  public:
+    /**
+     * Maps the file at the path.
+     * @param path Path to the file.
+     * @throws std::runtime_error when the file can't be opened or mapped.
+     */
+    explicit mapped_file(const std::string& path);
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    /**
+     * Unmaps the file.
+     */
+    ~mapped_file() noexcept;
+
+    /**
+     * @return Pointer to the start of the mapping.
+     */
+    [[nodiscard]] const std::byte* data() const noexcept { return this->mapping; }
+
+    /**
+     * @return Size of the mapping.
+     */
+    [[nodiscard]] uint64_t size() const noexcept { return this->mapping_size; }
+
+    /**
+     * @param offset Offset.
+     * @param length Length.
+     * @return True if the range lies within the mapping.
+     */
+    [[nodiscard]] bool contains(const uint64_t offset, const uint64_t length) const noexcept
+    {
+      return offset <= this->mapping_size && length <= this->mapping_size - offset;
+    }
+
+    /**
+     * Returns view of the mapped range.
+     * @param offset Offset.
+     * @param length Length.
+     * @throws std::runtime_error when the range lies outside of the mapping.
+     * @return View of the range.
+     */
+    [[nodiscard]] std::span<const std::byte> view(uint64_t offset, uint64_t length) const;
+
+    /**
+     * Reads blob from the mapping.
+     * @tparam Blob  Blob type.
+     * @param blob   Blob.
+     * @param offset Offset.
+     * @return True if reading was successful, otherwise returns false.
+     */
+    template <typename Blob>
+    bool read(Blob& blob, const uint64_t offset) const
+    {
+      if (!this->contains(offset, sizeof blob))
+        return false;
+      std::memcpy(&blob, this->mapping + offset, sizeof blob);
+      return true;
+    }
+
+    /**
+     * Hints the kernel that the range will be needed soon.
+     * @param offset Offset.
+     * @param length Length.
+     */
+    void prefetch(uint64_t offset, uint64_t length) const noexcept;
+
+  private:
+    const std::byte* mapping = nullptr;
+    uint64_t mapping_size = 0;
+  };
+
+  /**
+   * Asynchronous positional reads submitted through io_uring, using the raw
+   * system calls. Reads are prepared into the submission queue, submitted in
+   * one system call and their completions reaped in the order they arrive.
+   * Not thread-safe.
+   */
+  class io_ring
+  {
+  public:
+    /**
+     * Completion of a read.
+     */
+    struct completion
+    {
+      //! User data of the read.
+      uint64_t user_data;
+      //! Count of bytes read, or a negated errno value.
+      int32_t result;
+    };
+
+    /**
+     * Sets up the ring.
+     * @param entries Count of the submission queue entries.
+     * @throws std::runtime_error when io_uring or its read operation is not available.
+     */
+    explicit io_ring(uint32_t entries);
+
+    io_ring(const io_ring&) = delete;
+    io_ring& operator=(const io_ring&) = delete;
+
+    /**
+     * Tears down the ring. Reads in flight must be completed beforehand.
+     */
+    ~io_ring() noexcept;
+
+    /**
+     * Prepares a read into the submission queue.
+     * @param input     File to read from.
+     * @param buffer    Buffer.
+     * @param size      Buffer size.
+     * @param offset    Offset.
+     * @param user_data User data of the read's completion.
+     * @return False if the submission queue is full, otherwise returns true.
+     */
+    bool prepare_read(
+      const file& input,
+      std::byte* buffer,
+      uint32_t size,
+      uint64_t offset,
+      uint64_t user_data) noexcept;
+
+    /**
+     * Submits the prepared reads.
+     * @return True if successful, otherwise returns false.
+     */
+    bool submit() noexcept;
+
+    /**
+     * @return Count of the prepared reads not submitted yet.
+     */
+    [[nodiscard]] uint32_t pending() const noexcept { return this->prepared; }
+
+    /**
+     * Waits for a completion.
+     * @throws std::runtime_error when waiting fails.
+     * @return Completion.
+     */
+    completion wait();
+
+  private:
+    void release() noexcept;
+
+    int ring_descriptor = -1;
+    uint32_t prepared = 0;
+
+    void* submission_ring = nullptr;
+    size_t submission_ring_size = 0;
+    void* completion_ring = nullptr;
+    size_t completion_ring_size = 0;
+    void* submission_entries = nullptr;
+    size_t submission_entries_size = 0;
+
+    uint32_t* submission_head = nullptr;
+    uint32_t* submission_tail = nullptr;
+    uint32_t* submission_array = nullptr;
+    uint32_t submission_mask = 0;
+    uint32_t submission_capacity = 0;
+
+    uint32_t* completion_head = nullptr;
+    uint32_t* completion_tail = nullptr;
+    void* completion_entries = nullptr;
+    uint32_t completion_mask = 0;
+  };
+
+  /**
+   * Statistics of written data.
+   */
+  struct write_stats
+  {
+    //! Count of write system calls.
+    uint64_t syscalls{};
+    //! Count of written bytes.
+    uint64_t bytes{};
+
+    write_stats& operator+=(const write_stats& other) noexcept
+    {
+      this->syscalls += other.syscalls;
+      this->bytes += other.bytes;
+      return *this;
+    }
+  };
+
+  /**
+   * Sequential writer which coalesces small writes to the file in a large,
+   * page aligned buffer. Data larger than the buffer is written along with
+   * the buffered data in a single vectored write, without being copied.
+   * The writer has to be flushed, buffered data is discarded on destruction.
+   */
+  class buffered_writer
+  {
+  public:
+    //! Default capacity of the buffer.
+    static constexpr size_t DEFAULT_CAPACITY = 4 * 1024 * 1024;
+
+    /**
+     * Constructs the writer.
+     * @param output   File to write to.
+     * @param offset   Offset the writing starts at.
+     * @param capacity Capacity of the buffer.
+     */
+    buffered_writer(const file& output, uint64_t offset, size_t capacity = DEFAULT_CAPACITY);
+
+    buffered_writer(const buffered_writer&) = delete;
+    buffered_writer& operator=(const buffered_writer&) = delete;
+
+    /**
+     * Appends buffer to the written data.
+     * @param buffer Buffer.
+     * @param size   Buffer size.
+     * @return True if successful, otherwise returns false.
+     */
+    bool write(const std::byte* buffer, uint64_t size) noexcept;
+
+    /**
+     * Appends blob to the written data.
+     * @tparam Blob Blob type.
+     * @param blob  Blob.
+     * @return True if successful, otherwise returns false.
+     */
+    template <typename Blob>
+    bool write(const Blob& blob) noexcept
+    {
+      return write(reinterpret_cast<const std::byte*>(&blob), sizeof blob);
+    }
+
+    /**
+     * Flushes the buffered data and skips the range, which is written by other means.
+     * @param length Length of the skipped range.
+     * @return True if successful, otherwise returns false.
+     */
+    bool skip(uint64_t length) noexcept;
+
+    /**
+     * Writes the buffered data to the file.
+     * @return True if successful, otherwise returns false.
+     */
+    bool flush() noexcept;
+
+    /**
+     * @return Offset the next data is written at.
+     */
+    [[nodiscard]] uint64_t offset() const noexcept { return this->buffer_offset + this->buffer_size; }
+
+    /**
+     * @return Statistics of the data written so far.
+     */
+    [[nodiscard]] const write_stats& stats() const noexcept { return this->statistics; }
+
+  private:
+    struct buffer_deleter
+    {
+      void operator()(std::byte* buffer) const noexcept;
+    };
+
+    const file& output;
+    std::unique_ptr<std::byte, buffer_deleter> buffer;
+    size_t buffer_capacity;
+    size_t buffer_size = 0;
+    //! Offset of the buffered data in the file.
+    uint64_t buffer_offset;
+    write_stats statistics;
+  };
+
+  /**
+   * Copies a range of bytes between files. Uses copy_file_range, so the data
+   * does not pass through user space and may be reflinked by the filesystem,
+   * falling back to positional reads and writes where it is not supported.
+   * @param source             Source file.
+   * @param source_offset      Offset in the source file.
+   * @param destination        Destination file.
+   * @param destination_offset Offset in the destination file.
+   * @param length             Length of the range.
+   * @return True if the whole range was copied, otherwise returns false.
+   */
+  bool copy_range(
+    const file& source,
+    uint64_t source_offset,
+    const file& destination,
+    uint64_t destination_offset,
+    uint64_t length) noexcept;
+
+} // namespace libpak
+
+#endif // LIBPAK_IO_HPP
@@ -5,10 +5,19 @@
 #ifndef libpak_libpak_HPP
 #define libpak_libpak_HPP
 
+#include "codec.hpp"
+#include "compact_index.hpp"
+#include "compression.hpp"
 #include "definitions.hpp"
+#include "io.hpp"
+#include "scratch.hpp"
 
+#include <chrono>
 #include <fstream>
+#include <functional>
 #include <memory>
+#include <span>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 
@@ -17,6 +26,17 @@ namespace libpak
 
   using asset_map = std::unordered_map<std::string, asset>;
 
+  /**
+   * Backend used to access the resource file.
+   */
+  enum class backend
+  {
+    //! Buffered stream reads.
+    stream,
+    //! Read-only memory mapping.
+    mapped,
+  };
+
   /**
    * Provides encapsulation for read and write operations on streams.
    */
@@ -121,6 +141,94 @@ namespace libpak
     std::shared_ptr<std::ostream> sink;
   };
 
+  /**
+   * Statistics of a single thread taking part in a read.
+   */
+  struct worker_stats
+  {
+    //! Count of processed assets.
+    uint64_t assets{};
+    //! Count of consumed bytes.
+    uint64_t bytes_in{};
+    //! Count of produced bytes.
+    uint64_t bytes_out{};
+    //! Time spent working.
+    std::chrono::nanoseconds busy_time{};
+
+    /**
+     * @return Produced bytes per second of busy time.
+     */
+    [[nodiscard]] double throughput() const noexcept
+    {
+      const auto seconds = std::chrono::duration<double>(busy_time).count();
+      return seconds == 0 ? 0 : static_cast<double>(bytes_out) / seconds;
+    }
+  };
+
+  /**
+   * Statistics of a data read.
+   */
+  struct read_stats
+  {
+    //! Wall-clock time of the read.
+    std::chrono::nanoseconds wall_time{};
+    //! Statistics of the thread reading the embedded data.
+    worker_stats io{};
+    //! Statistics of the inflate worker threads.
+    std::vector<worker_stats> workers{};
+  };
+
+  /**
+   * Statistics of the payload deduplication.
+   */
+  struct dedup_stats
+  {
+    //! Count of assets sharing the data of another asset.
+    uint64_t assets{};
+    //! Count of bytes not written thanks to the shared data.
+    uint64_t bytes_saved{};
+  };
+
+  /**
+   * Represents asset data encoded for writing.
+   */
+  struct encoded_asset
+  {
+    //! Whether there is data to write.
+    bool has_data{};
+    //! Whether the embedded data is copied from the asset's source resource as is.
+    bool copy_through{};
+    //! Whether the embedded data is compressed.
+    bool compressed{};
+    //! Time spent sampling and compressing the data.
+    std::chrono::nanoseconds compression_time{};
+    //! Compressed data, empty if the data is stored as is.
+    scratch_buffer compressed_data{};
+    //! Data to embed, either the compressed data or the asset's data.
+    std::span<const std::byte> embedded_data{};
+
+    uint32_t crc_decompressed{};
+    uint32_t checksum_decompressed{};
+    uint32_t crc_embedded{};
+    uint32_t checksum_embedded{};
+
+    /**
+     * Updates the header to describe the encoded data.
+     * @param header Asset header.
+     * @param offset Offset the data is written at.
+     */
+    void apply(asset_header& header, const uint32_t offset) const noexcept
+    {
+      header.embedded_data_offset = offset;
+      header.embedded_data_length = embedded_data.size();
+      header.is_data_compressed = compressed;
+      header.crc_decompressed = crc_decompressed;
+      header.checksum_decompressed = checksum_decompressed;
+      header.crc_embedded = crc_embedded;
+      header.checksum_embedded = checksum_embedded;
+    }
+  };
+
   /**
    * Represents a single resource which holds assets and their accompanying data.
    */
@@ -138,48 +246,136 @@ namespace libpak
         this->create();
     };
 
+    /**
+     * Opens the resource with the selected backend and reads the pak and content headers.
+     * @throws std::runtime_error
+     */
+    void open();
+
     /**
      * Reads the resource and indexes the assets.
-     * @param data Whether to read the data of the indexed assets.
+     * @param data Whether to read the data of the indexed assets, see read_all_asset_data().
      * @throws std::runtime_error
      */
     void read(bool data = false);
 
     /**
-     * Reads asset from the resource.
-     * @param asset Asset. Must contain a valid offset or the read cursor must be before a valid
-     * header.
-     * @param data  Whether to read the assets data.
+     * Reads the resource into the compact index only, leaving the asset map empty.
+     * Meant for index-only tools, as the compact index takes a fraction of
+     * the memory of the asset map.
      * @throws std::runtime_error
      */
-    void read_asset_header(asset& asset);
+    void read_compact();
 
     /**
-     * Reads assets data from the resource.
-     * @param asset Asset. Must contain a valid data offset or the read cursor must be before valid
-     * data.
+     * Reads a consecutive range of asset headers from the header table with a single read.
+     * @param first   Index of the first asset header.
+     * @param headers Headers to read, the size of the span determines the count.
      * @throws std::runtime_error
      */
-    void read_asset_data(asset& asset);
+    void read_asset_headers(uint32_t first, std::span<asset_header> headers);
 
     /**
-     * Writes the resource.
+     * Reads assets data from the resource, inflating it when decompression is enabled.
+     * Uses positional reads, so it is safe to call from many threads at once as long as
+     * each thread reads a different asset.
+     * @param asset Asset. Must contain a valid data offset.
      * @throws std::runtime_error
      */
-    void write();
+    void read_asset_data(asset& asset) const;
+
+    /**
+     * Reads assets embedded data from the resource as is. Thread-safe.
+     * @param asset Asset. Must contain a valid data offset.
+     * @throws std::runtime_error
+     * @return Embedded data, in a buffer of the scratch pool.
+     */
+    [[nodiscard]] scratch_buffer read_embedded_data(const asset& asset) const;
+
+    /**
+     * Reads data of all indexed assets in the order it is laid out in the resource.
+     * When decompression is enabled, the calling thread reads the embedded data while
+     * worker threads inflate it. Statistics are stored in read_statistics.
+     * @throws std::runtime_error
+     */
+    void read_all_asset_data();
 
     /**
-     * Writes the asset header.
+     * Reads data of a batch of assets, such as all the assets of a level. The assets are
+     * sorted by their data offset and nearby data is merged into extents, which are read
+     * asynchronously through io_uring, or by a pool of threads when it is not available.
+     * The mapped backend prefetches the extents ahead of the delivered assets instead.
+     * Data is inflated when decompression is enabled, otherwise the assets borrow it from
+     * the extent. Statistics are stored in read_statistics.
+     * @param batch      Assets to read.
+     * @param completion Called on the calling thread for each asset, as its data arrives.
+     * @throws std::runtime_error
+     */
+    void read_assets(std::span<asset* const> batch, const std::function<void(asset&)>& completion);
+
+    /**
+     * Loads the asset's payload through the payload cache. Thread-safe.
      * @param asset Asset.
      * @throws std::runtime_error
+     * @return Payload.
      */
-    void write_asset_header(const asset& asset);
+    shared_payload load_payload(const asset& asset);
 
     /**
-     * Writes the asset's data.
+     * Returns view of the asset's embedded data inside of the mapping.
+     * The view is valid until the resource is read again or destroyed.
      * @param asset Asset.
+     * @throws std::runtime_error when the resource is not mapped or the data is out of bounds.
+     * @return View of the embedded data.
+     */
+    [[nodiscard]] std::span<const std::byte> view_asset_data(const asset& asset) const;
+
+    /**
+     * Writes the resource to its path.
+     * @throws std::runtime_error
+     */
+    void write();
+
+    /**
+     * Writes the resource to the path, which becomes the resource's path.
+     * Assets which are not patched and were indexed from an open resource
+     * have their embedded data copied through from it as is, with their CRCs
+     * and checksums reused. Assets marked as patched or with modified data are
+     * compressed and hashed on worker threads, and written in order by the
+     * calling thread through a buffered writer. The header table is assembled
+     * in memory and written at once after the data. The resource is written
+     * to a temporary file renamed over the path, so assets may copy or borrow
+     * their data from the file being replaced.
+     * @param path Path to write the resource to.
+     * @throws std::runtime_error
+     */
+    void write(const std::string& path);
+
+    /**
+     * Writes only patched and added assets into the existing resource in place.
+     * Their data is placed into holes left in the data sector, or appended,
+     * never over data referenced by a header on disk. Only their headers, the
+     * content header and the pak header are rewritten, the rest of the
+     * resource is left alone. Assets removed from the asset map require a
+     * full write().
+     * @throws std::runtime_error when the resource was not read, or its header table is full.
      */
-    void write_asset_data(asset& asset);
+    void write_incremental();
+
+    /**
+     * Compresses and hashes the asset's data for writing. Thread-safe.
+     * @param asset Asset. Must outlive the encoded asset, which may view its data.
+     * @param codec  Codec compressing the data.
+     * @param policy  Compression policy, compresses at the highest level when null.
+     * @param scratch Pool of the compression buffers, allocates them when null.
+     * @throws std::runtime_error
+     * @return Encoded asset.
+     */
+    [[nodiscard]] static encoded_asset encode_asset_data(
+      const asset& asset,
+      const codec& codec = get_codec(default_codec_backend()),
+      const libpak::compression_policy* policy = nullptr,
+      scratch_pool* scratch = nullptr);
 
     /**
      * Create the resource file descriptors.
@@ -199,11 +395,108 @@ namespace libpak
      */
     asset& operator[](const std::string& name) { return this->assets.at(name);}
 
+    /**
+     * Finds asset by its UTF-8 path without allocating.
+     * @param path Asset path.
+     * @return Indexed asset, or nullptr if there is no such asset.
+     */
+    [[nodiscard]] const asset* find(std::string_view path) const;
+
+    /**
+     * Finds asset by its UTF-8 path without allocating.
+     * @param path Asset path.
+     * @return Indexed asset, or nullptr if there is no such asset.
+     */
+    [[nodiscard]] asset* find(std::string_view path);
+
+    /**
+     * Finds asset by its UTF-16 path without allocating.
+     * @param path Asset path.
+     * @return Indexed asset, or nullptr if there is no such asset.
+     */
+    [[nodiscard]] const asset* find(std::u16string_view path) const;
+
+    /**
+     * Finds asset by its UTF-16 path without allocating.
+     * @param path Asset path.
+     * @return Indexed asset, or nullptr if there is no such asset.
+     */
+    [[nodiscard]] asset* find(std::u16string_view path);
+
+    /**
+     * Rebuilds the path index. Called by read(), call it again after adding
+     * or removing assets.
+     */
+    void reindex();
+
     /**
      * Path to resource.
      */
     std::string resource_path;
 
+    /**
+     * Backend used by read operations.
+     */
+    backend resource_backend = backend::stream;
+
+    /**
+     * Whether read operations inflate compressed asset data.
+     */
+    bool decompress = false;
+
+    /**
+     * Count of worker threads used by parallel operations, zero for one per core.
+     */
+    unsigned worker_count = 0;
+
+    /**
+     * Count of the extents read at once by read_assets().
+     */
+    uint32_t queue_depth = 32;
+
+    /**
+     * Codec compressing and decompressing the asset data.
+     */
+    codec_backend compression_backend = default_codec_backend();
+
+    /**
+     * Pool of the scratch buffers for the embedded and compressed data,
+     * reused across assets.
+     */
+    mutable scratch_pool scratch;
+
+    /**
+     * Policy deciding how the assets marked as compressed are compressed.
+     * When not set, they are compressed at the highest level.
+     */
+    std::shared_ptr<const libpak::compression_policy> compression_policy;
+
+    /**
+     * Report of the compression of the last write.
+     */
+    struct compression_report compression_report;
+
+    /**
+     * Statistics of the last data read.
+     */
+    read_stats read_statistics;
+
+    /**
+     * Statistics of the last write.
+     */
+    write_stats write_statistics;
+
+    /**
+     * Whether write() stores byte-identical payloads once, with the headers
+     * of their assets referencing the same embedded data.
+     */
+    bool deduplicate = false;
+
+    /**
+     * Statistics of the deduplication of the last write.
+     */
+    dedup_stats dedup_statistics;
+
     /**
      * PAK header
      */
@@ -224,19 +517,34 @@ namespace libpak
     asset_map assets;
 
     /**
-     * Resource stream.
+     * Compact index filled by read_compact().
+     */
+    compact_index index;
+
+    /**
+     * Index of asset paths used by find().
+     */
+    path_index paths;
+
+    /**
+     * Assets in the order of the path index entries.
+     */
+    std::vector<asset*> indexed_assets;
+
+    /**
+     * Cache of payloads loaded on demand through asset::payload().
      */
-    std::shared_ptr<stream> resource_stream;
+    payload_cache cache;
 
     /**
-     * Resource input stream.
+     * Resource positional reader, present only with the stream backend.
      */
-    std::shared_ptr<std::ifstream> input_stream;
+    std::shared_ptr<file> resource_file;
 
     /**
-     * Resource output stream.
+     * Resource mapping, present only with the mapped backend.
      */
-    std::shared_ptr<std::ofstream> output_stream;
+    std::shared_ptr<mapped_file> resource_mapping;
   };
 
 } // namespace libpak
@@ -0,0 +1,182 @@
+#ifndef LIBPAK_PATH_INDEX_HPP
+#define LIBPAK_PATH_INDEX_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace libpak
+{
+
+  /**
+   * Open-addressing hash index of asset paths. The index stores only hashes and
+   * entry numbers, the paths themselves are fetched through a key function, so
+   * the index works over any storage of UTF-16 paths. Paths are hashed over
+   * their code points, which makes UTF-8 and UTF-16 lookups allocation-free.
+   */
+  class path_index
+  {
+  public:
+    /**
+     * Hashes UTF-16 path.
+     * @param path Path.
+     * @return Hash.
+     */
+    [[nodiscard]] static uint64_t hash(std::u16string_view path) noexcept;
+
+    /**
+     * Hashes UTF-8 path.
+     * @param path Path.
+     * @return Hash.
+     */
+    [[nodiscard]] static uint64_t hash(std::string_view path) noexcept;
+
+    /**
+     * Compares UTF-16 path with UTF-8 path by code points.
+     * @param lhs UTF-16 path.
+     * @param rhs UTF-8 path.
+     * @return True if the paths are equal.
+     */
+    [[nodiscard]] static bool equals(std::u16string_view lhs, std::string_view rhs) noexcept;
+
+    /**
+     * Encodes UTF-16 path as UTF-8.
+     * @param path Path.
+     * @return UTF-8 path.
+     */
+    [[nodiscard]] static std::string to_utf8(std::u16string_view path);
+
+    /**
+     * Encodes UTF-8 path as UTF-16.
+     * @param path Path.
+     * @return UTF-16 path.
+     */
+    [[nodiscard]] static std::u16string to_utf16(std::string_view path);
+
+    /**
+     * Builds the index. Of duplicate paths the last entry is indexed,
+     * as the resource's assets keep it.
+     * @tparam Key  Key function, `std::u16string_view(uint32_t entry)`.
+     * @param count Count of entries.
+     * @param key   Key function.
+     */
+    template <typename Key>
+    void build(const uint32_t count, Key&& key)
+    {
+      // keep the load factor at or below one half
+      uint64_t capacity = 16;
+      while (capacity < static_cast<uint64_t>(count) * 2)
+        capacity *= 2;
+
+      this->slots.assign(capacity, {});
+      this->mask = capacity - 1;
+      this->count = 0;
+
+      for (uint32_t entry = 0; entry < count; ++entry)
+      {
+        const auto path = key(entry);
+        const uint64_t path_hash = hash(path);
+        for (uint64_t position = path_hash & this->mask;; position = (position + 1) & this->mask)
+        {
+          auto& slot = this->slots[position];
+          if (slot.entry == EMPTY)
+          {
+            slot = {tag(path_hash), entry};
+            ++this->count;
+            break;
+          }
+          if (slot.tag == tag(path_hash) && key(slot.entry) == path)
+          {
+            slot.entry = entry;
+            break;
+          }
+        }
+      }
+    }
+
+    /**
+     * Finds entry by UTF-16 path.
+     * @tparam Key Key function, `std::u16string_view(uint32_t entry)`.
+     * @param path Path.
+     * @param key  Key function.
+     * @return Entry, or empty optional if the path is not indexed.
+     */
+    template <typename Key>
+    [[nodiscard]] std::optional<uint32_t> find(const std::u16string_view path, Key&& key) const
+    {
+      return this->probe(hash(path), [&](const uint32_t entry) { return key(entry) == path; });
+    }
+
+    /**
+     * Finds entry by UTF-8 path.
+     * @tparam Key Key function, `std::u16string_view(uint32_t entry)`.
+     * @param path Path.
+     * @param key  Key function.
+     * @return Entry, or empty optional if the path is not indexed.
+     */
+    template <typename Key>
+    [[nodiscard]] std::optional<uint32_t> find(const std::string_view path, Key&& key) const
+    {
+      return this->probe(hash(path), [&](const uint32_t entry) { return equals(key(entry), path); });
+    }
+
+    /**
+     * @return Count of indexed entries, which have distinct paths.
+     */
+    [[nodiscard]] uint32_t size() const noexcept { return this->count; }
+
+    /**
+     * Clears the index.
+     */
+    void clear() noexcept
+    {
+      this->slots.clear();
+      this->mask = 0;
+      this->count = 0;
+    }
+
+  private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    /**
+     * Index slot, the tag holds the upper half of the hash to reject
+     * most mismatches without touching the path.
+     */
+    struct slot
+    {
+      uint32_t tag{};
+      uint32_t entry{EMPTY};
+    };
+
+    [[nodiscard]] static uint32_t tag(const uint64_t path_hash) noexcept
+    {
+      return static_cast<uint32_t>(path_hash >> 32);
+    }
+
+    template <typename Equals>
+    [[nodiscard]] std::optional<uint32_t> probe(const uint64_t path_hash, Equals&& equals) const
+    {
+      if (this->slots.empty())
+        return std::nullopt;
+
+      const uint32_t path_tag = tag(path_hash);
+      for (uint64_t position = path_hash & this->mask;; position = (position + 1) & this->mask)
+      {
+        const auto& slot = this->slots[position];
+        if (slot.entry == EMPTY)
+          return std::nullopt;
+        if (slot.tag == path_tag && equals(slot.entry))
+          return slot.entry;
+      }
+    }
+
+    std::vector<slot> slots;
+    uint64_t mask = 0;
+    uint32_t count = 0;
+  };
+
+} // namespace libpak
+
+#endif // LIBPAK_PATH_INDEX_HPP
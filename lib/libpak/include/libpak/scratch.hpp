@@ -0,0 +1,155 @@
+#ifndef LIBPAK_SCRATCH_HPP
+#define LIBPAK_SCRATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace libpak
+{
+
+  class scratch_pool;
+
+  /**
+   * Uninitialized scratch buffer, returned to its pool when destroyed.
+   */
+  class scratch_buffer
+  {
+  public:
+    scratch_buffer() noexcept = default;
+
+    /**
+     * Allocates a buffer, which is not pooled.
+     * @param size Size of the buffer.
+     */
+    explicit scratch_buffer(uint64_t size);
+
+    scratch_buffer(scratch_buffer&& other) noexcept;
+    scratch_buffer& operator=(scratch_buffer&& other) noexcept;
+
+    /**
+     * Returns the buffer to its pool.
+     */
+    ~scratch_buffer() noexcept;
+
+    /**
+     * @return Pointer to the buffer.
+     */
+    [[nodiscard]] std::byte* data() const noexcept { return this->block.get(); }
+
+    /**
+     * @return Size of the buffer.
+     */
+    [[nodiscard]] uint64_t size() const noexcept { return this->buffer_size; }
+
+    /**
+     * @return Whether the buffer is empty.
+     */
+    [[nodiscard]] bool empty() const noexcept { return this->buffer_size == 0; }
+
+    /**
+     * @return Span of the buffer.
+     */
+    [[nodiscard]] std::span<std::byte> span() const noexcept { return {this->block.get(), this->buffer_size}; }
+
+    /**
+     * Shrinks the buffer, the capacity stays.
+     * @param size Size, at most the current size.
+     */
+    void truncate(uint64_t size) noexcept;
+
+    /**
+     * Returns the buffer to its pool, leaving it empty.
+     */
+    void reset() noexcept;
+
+  private:
+    friend class scratch_pool;
+
+    scratch_buffer(scratch_pool* pool, std::unique_ptr<std::byte[]> block, uint64_t capacity, uint64_t size) noexcept;
+
+    scratch_pool* pool = nullptr;
+    std::unique_ptr<std::byte[]> block;
+    uint64_t capacity = 0;
+    uint64_t buffer_size = 0;
+  };
+
+  /**
+   * Statistics of the scratch pool.
+   */
+  struct scratch_stats
+  {
+    //! Count of the allocated blocks.
+    uint64_t allocations{};
+    //! Count of the acquisitions served by a pooled block.
+    uint64_t reuses{};
+    //! Total size of the allocated blocks.
+    uint64_t bytes_allocated{};
+    //! Size of the blocks currently kept in the pool.
+    uint64_t bytes_retained{};
+  };
+
+  /**
+   * Pool of uninitialized scratch buffers, reused across assets instead of
+   * allocating and zero-filling a buffer for each of them. Blocks are sized
+   * in powers of two, so buffers of similar sizes share them. Thread-safe.
+   * The buffers must not outlive the pool.
+   */
+  class scratch_pool
+  {
+  public:
+    //! Default size of the blocks kept in the pool.
+    static constexpr uint64_t DEFAULT_RETAINED_LIMIT = 64 * 1024 * 1024;
+
+    scratch_pool() = default;
+    scratch_pool(const scratch_pool&) = delete;
+    scratch_pool& operator=(const scratch_pool&) = delete;
+
+    /**
+     * Acquires an uninitialized buffer.
+     * @param size Size of the buffer.
+     * @throws std::runtime_error when the buffer can't be allocated.
+     * @return Buffer.
+     */
+    [[nodiscard]] scratch_buffer acquire(uint64_t size);
+
+    /**
+     * Sets the size of the blocks kept in the pool, releasing blocks above it.
+     * @param limit Size of the blocks kept in the pool.
+     */
+    void set_retained_limit(uint64_t limit) noexcept;
+
+    /**
+     * Releases the pooled blocks.
+     */
+    void clear() noexcept;
+
+    /**
+     * @return Statistics of the pool.
+     */
+    [[nodiscard]] scratch_stats stats() const noexcept;
+
+  private:
+    friend class scratch_buffer;
+
+    //! Takes the block back into the pool, or frees it.
+    void release(std::unique_ptr<std::byte[]> block, uint64_t capacity) noexcept;
+
+    struct pooled_block
+    {
+      std::unique_ptr<std::byte[]> block;
+      uint64_t capacity;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<pooled_block> blocks;
+    uint64_t retained_limit = DEFAULT_RETAINED_LIMIT;
+    scratch_stats statistics;
+  };
+
+} // namespace libpak
+
+#endif // LIBPAK_SCRATCH_HPP
@@ -0,0 +1,310 @@
+#include "libpak/algorithms.hpp"
+
+#include <algorithm>
+
+#include <zlib.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LIBPAK_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+//! Alicia checksum implementation signature.
+using checksum_func = int32_t (*)(const char*, uint64_t);
+
+//! Fused CRC32 and alicia checksum implementation signature.
+using digest_func = libpak::alg::digest (*)(const char*, uint64_t);
+
+//! Block size of the blocked digest, small enough to stay in the L1 cache.
+constexpr uint64_t DIGEST_BLOCK_SIZE = 16 * 1024;
+
+/**
+ * Perform CRC32 and alicia checksum over cache-sized blocks, so both
+ * passes over a block are served from the cache.
+ * @param buffer Buffer
+ * @param length Length
+ * @return Digest
+ */
+libpak::alg::digest crc32_checksum_blocked(const char* buffer, uint64_t length)
+{
+  uint32_t crc = 0;
+  uint32_t checksum = 0;
+  while (length != 0)
+  {
+    const uint64_t block = std::min(length, DIGEST_BLOCK_SIZE);
+    crc = ::crc32(crc, reinterpret_cast<const Bytef*>(buffer), static_cast<uInt>(block));
+    checksum += static_cast<uint32_t>(libpak::alg::alicia_checksum(buffer, block));
+    buffer += block;
+    length -= block;
+  }
+  return {crc, static_cast<int32_t>(checksum)};
+}
+
+#ifdef LIBPAK_X86_SIMD
+
+/**
+ * Perform alicia checksum on a buffer with SSE2.
+ *
+ * Flipping the sign bit turns every signed byte into an unsigned byte biased
+ * by 128, which psadbw sums horizontally into 64-bit lanes. The bias is
+ * subtracted at the end.
+ * @param buffer Buffer
+ * @param length Length
+ * @return Checksum
+ */
+__attribute__((target("sse2"))) int32_t alicia_checksum_sse2(const char* buffer, uint64_t length)
+{
+  const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sums = zero;
+
+  const uint64_t blocks = length / 16;
+  for (uint64_t block = 0; block < blocks; ++block, buffer += 16)
+  {
+    const __m128i bytes = _mm_xor_si128(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer)), bias);
+    sums = _mm_add_epi64(sums, _mm_sad_epu8(bytes, zero));
+  }
+
+  sums = _mm_add_epi64(sums, _mm_unpackhi_epi64(sums, sums));
+  uint32_t result = static_cast<uint32_t>(_mm_cvtsi128_si32(sums))
+    - static_cast<uint32_t>(blocks * 16 * 128);
+
+  return static_cast<int32_t>(
+    result + static_cast<uint32_t>(libpak::alg::alicia_checksum_scalar(buffer, length % 16)));
+}
+
+/**
+ * Perform alicia checksum on a buffer with AVX2.
+ * @see alicia_checksum_sse2
+ * @param buffer Buffer
+ * @param length Length
+ * @return Checksum
+ */
+__attribute__((target("avx2"))) int32_t alicia_checksum_avx2(const char* buffer, uint64_t length)
+{
+  const __m256i bias = _mm256_set1_epi8(static_cast<char>(0x80));
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i sums0 = zero;
+  __m256i sums1 = zero;
+
+  // two independent accumulators hide the latency of the additions
+  const uint64_t blocks = length / 64;
+  for (uint64_t block = 0; block < blocks; ++block, buffer += 64)
+  {
+    const __m256i bytes0 = _mm256_xor_si256(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer)), bias);
+    const __m256i bytes1 = _mm256_xor_si256(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + 32)), bias);
+    sums0 = _mm256_add_epi64(sums0, _mm256_sad_epu8(bytes0, zero));
+    sums1 = _mm256_add_epi64(sums1, _mm256_sad_epu8(bytes1, zero));
+  }
+
+  const __m256i sums = _mm256_add_epi64(sums0, sums1);
+  __m128i lanes = _mm_add_epi64(
+    _mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+  lanes = _mm_add_epi64(lanes, _mm_unpackhi_epi64(lanes, lanes));
+  uint32_t result = static_cast<uint32_t>(_mm_cvtsi128_si32(lanes))
+    - static_cast<uint32_t>(blocks * 64 * 128);
+
+  return static_cast<int32_t>(
+    result + static_cast<uint32_t>(alicia_checksum_sse2(buffer, length % 64)));
+}
+
+/**
+ * Perform CRC32 and alicia checksum in a single pass with PCLMULQDQ.
+ *
+ * The CRC is computed by folding four 128-bit lanes with carry-less
+ * multiplication, followed by a Barrett reduction, as described in Intel's
+ * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+ * The constants are for the bit-reflected zlib polynomial 0xEDB88320.
+ * Every 16 bytes loaded for the CRC are also summed for the alicia checksum.
+ * @param buffer Buffer
+ * @param length Length
+ * @return Digest
+ */
+__attribute__((target("pclmul,sse4.1"))) libpak::alg::digest crc32_checksum_pclmul(
+  const char* buffer,
+  uint64_t length)
+{
+  if (length < 64)
+    return crc32_checksum_blocked(buffer, length);
+
+  alignas(16) static constexpr uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+  alignas(16) static constexpr uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+  alignas(16) static constexpr uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+  alignas(16) static constexpr uint64_t poly[] = {0x01db710641, 0x01f7011641};
+
+  const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sums = zero;
+  const auto sum = [&](const __m128i bytes) {
+    sums = _mm_add_epi64(sums, _mm_sad_epu8(_mm_xor_si128(bytes, bias), zero));
+  };
+
+  // only whole 16 byte blocks are folded, the rest is handled by zlib
+  const uint64_t folded_length = length & ~uint64_t{15};
+  const char* const tail = buffer + folded_length;
+  const uint64_t tail_length = length - folded_length;
+  const auto load = [](const char* address) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(address));
+  };
+
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+  x1 = load(buffer + 0x00);
+  x2 = load(buffer + 0x10);
+  x3 = load(buffer + 0x20);
+  x4 = load(buffer + 0x30);
+  sum(x1);
+  sum(x2);
+  sum(x3);
+  sum(x4);
+
+  // initial crc of zero, inverted
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(0xFFFFFFFF)));
+  x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+
+  buffer += 64;
+  length = folded_length - 64;
+
+  // fold four lanes at a time
+  while (length >= 64)
+  {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+    y5 = load(buffer + 0x00);
+    y6 = load(buffer + 0x10);
+    y7 = load(buffer + 0x20);
+    y8 = load(buffer + 0x30);
+    sum(y5);
+    sum(y6);
+    sum(y7);
+    sum(y8);
+
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+    buffer += 64;
+    length -= 64;
+  }
+
+  // fold the four lanes into one
+  x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+  for (const __m128i next : {x2, x3, x4})
+  {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, next), x5);
+  }
+
+  // fold the remaining 16 byte blocks
+  while (length >= 16)
+  {
+    x2 = load(buffer);
+    sum(x2);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    buffer += 16;
+    length -= 16;
+  }
+
+  // fold 128 bits to 64 bits
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+
+  x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits
+  x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  uint32_t crc = ~static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+  crc = ::crc32(crc, reinterpret_cast<const Bytef*>(tail), static_cast<uInt>(tail_length));
+
+  sums = _mm_add_epi64(sums, _mm_unpackhi_epi64(sums, sums));
+  const uint32_t checksum = static_cast<uint32_t>(_mm_cvtsi128_si32(sums))
+    - static_cast<uint32_t>(folded_length * 128)
+    + static_cast<uint32_t>(libpak::alg::alicia_checksum_scalar(tail, tail_length));
+
+  return {crc, static_cast<int32_t>(checksum)};
+}
+
+#endif
+
+/**
+ * @return The best fused digest implementation for this CPU.
+ */
+digest_func select_digest() noexcept
+{
+#ifdef LIBPAK_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1"))
+    return crc32_checksum_pclmul;
+#endif
+  return crc32_checksum_blocked;
+}
+
+/**
+ * @return The best alicia checksum implementation for this CPU.
+ */
+checksum_func select_checksum() noexcept
+{
+#ifdef LIBPAK_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return alicia_checksum_avx2;
+  if (__builtin_cpu_supports("sse2"))
+    return alicia_checksum_sse2;
+#endif
+  return libpak::alg::alicia_checksum_scalar;
+}
+
+} // namespace
+
+int32_t libpak::alg::alicia_checksum_scalar(const char* buffer, uint64_t length)
+{
+  // unsigned accumulation wraps the same way the game's signed accumulation does
+  uint32_t result = 0;
+  for (; length != 0; --length, ++buffer)
+    result += static_cast<uint32_t>(static_cast<int32_t>(static_cast<signed char>(*buffer)));
+  return static_cast<int32_t>(result);
+}
+
+int32_t libpak::alg::alicia_checksum(const char* buffer, const uint64_t length)
+{
+  static const checksum_func checksum = select_checksum();
+  return checksum(buffer, length);
+}
+
+libpak::alg::digest libpak::alg::crc32_checksum(const char* buffer, const uint64_t length)
+{
+  static const digest_func digest = select_digest();
+  return digest(buffer, length);
+}
@@ -0,0 +1,137 @@
+#include "libpak/builder.hpp"
+#include "libpak/concurrency.hpp"
+#include "libpak/io.hpp"
+#include "libpak/libpak.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+
+//! Asset data encoded by a worker, ready to be written.
+struct built_asset
+{
+  //! Decompressed data, which the encoded asset may view.
+  std::vector<std::byte> data;
+  libpak::encoded_asset encoded;
+};
+
+} // namespace
+
+void libpak::builder::add(
+  const std::u16string_view path,
+  data_producer producer,
+  const bool compressed)
+{
+  asset_header header;
+  // keep the path null terminated
+  if (path.size() >= std::size(header.path))
+    throw std::runtime_error("asset path is too long");
+  std::ranges::copy(path, header.path);
+
+  header.asset_magic = 0x1;
+  header.is_asset_embedded = 1;
+  header.is_data_compressed = compressed;
+
+  this->headers.push_back(header);
+  this->producers.push_back(std::move(producer));
+}
+
+void libpak::builder::add_file(
+  const std::u16string_view path,
+  std::string file_path,
+  const bool compressed)
+{
+  this->add(
+    path,
+    [file_path = std::move(file_path)] {
+      const file input(file_path);
+      std::vector<std::byte> data(input.size());
+      if (!input.read_at(data.data(), data.size(), 0))
+        throw std::runtime_error("failed to read asset file");
+      return data;
+    },
+    compressed);
+}
+
+void libpak::builder::write()
+{
+  const file output(this->resource_path, file_mode::create);
+
+  const auto assets_count = static_cast<uint32_t>(this->headers.size());
+  const uint64_t header_table_end = PAK_ASSET_HEADERS_SECTOR
+    + static_cast<uint64_t>(assets_count) * sizeof(asset_header);
+  // the data follows the header table once it outgrows the default sector
+  buffered_writer data_writer(output, std::max<uint64_t>(
+    PAK_DATA_SECTOR, header_table_end + sizeof(struct data_header)));
+
+  // workers produce, compress and hash the data, while the calling thread
+  // writes it sequentially, so only a window of assets is held in memory
+  this->compression_report = {};
+  const auto& codec = get_codec(this->compression_backend);
+  const unsigned workers_count = resolve_worker_count(this->worker_count);
+  ordered_pipeline<built_asset>(
+    assets_count,
+    workers_count,
+    workers_count * 4,
+    [&](const size_t index) {
+      const auto producer = std::exchange(this->producers[index], nullptr);
+
+      asset asset;
+      asset.header = this->headers[index];
+      asset.data.own(producer());
+      asset.header.data_decompressed_length = asset.data.size();
+
+      auto encoded = resource::encode_asset_data(
+        asset, codec, this->compression_policy.get(), &this->scratch);
+      // moving the buffer keeps the viewed data in place
+      return built_asset{asset.data.release(), std::move(encoded)};
+    },
+    [&](const size_t index, built_asset&& built) {
+      auto& header = this->headers[index];
+      header.data_decompressed_length = built.data.size();
+
+      if (!built.encoded.has_data)
+        return;
+      this->compression_report.add(
+        {header.path},
+        built.data.size(),
+        built.encoded.embedded_data.size(),
+        header.is_data_compressed && not built.encoded.compressed,
+        built.encoded.compression_time);
+
+      const uint64_t data_offset = data_writer.offset();
+      const auto& embedded_data = built.encoded.embedded_data;
+      if (data_offset + embedded_data.size() > UINT32_MAX)
+        throw std::runtime_error("resource is too large");
+      if (!data_writer.write(embedded_data.data(), embedded_data.size()))
+        throw std::runtime_error("failed to write asset data");
+      built.encoded.apply(header, static_cast<uint32_t>(data_offset));
+    });
+
+  if (!data_writer.flush())
+    throw std::runtime_error("failed to write asset data");
+
+  this->content_header.assets_count = assets_count;
+  if (!output.write_at(this->content_header, PAK_CONTENT_SECTOR))
+    throw std::runtime_error("failed to write content header");
+
+  if (!output.write_at(
+        reinterpret_cast<const std::byte*>(this->headers.data()),
+        this->headers.size() * sizeof(asset_header),
+        PAK_ASSET_HEADERS_SECTOR))
+    throw std::runtime_error("failed to write asset headers");
+
+  if (!output.write_at(this->data_header, header_table_end))
+    throw std::runtime_error("failed to write data header");
+
+  this->pak_header.assets_count = assets_count;
+  this->pak_header.used_assets_count = assets_count;
+  this->pak_header.deleted_assets_count = 0;
+  this->pak_header.file_size = header_table_end + sizeof(struct data_header);
+
+  if (!output.write_at(this->pak_header, 0))
+    throw std::runtime_error("failed to write pak header");
+}
@@ -0,0 +1,81 @@
+#include "libpak/cache.hpp"
+#include "libpak/definitions.hpp"
+
+libpak::shared_payload libpak::payload_cache::find(const uint64_t key)
+{
+  std::scoped_lock lock(this->mutex);
+
+  const auto iterator = this->lookup.find(key);
+  if (iterator == this->lookup.end())
+  {
+    this->misses++;
+    return nullptr;
+  }
+
+  // move the entry to the front of the list
+  this->entries.splice(this->entries.begin(), this->entries, iterator->second);
+  this->hits++;
+  return iterator->second->payload;
+}
+
+void libpak::payload_cache::insert(const uint64_t key, shared_payload payload)
+{
+  if (payload == nullptr)
+    return;
+
+  std::scoped_lock lock(this->mutex);
+  if (payload->size() > this->budget)
+    return;
+
+  // replace the already cached payload
+  if (const auto iterator = this->lookup.find(key); iterator != this->lookup.end())
+  {
+    this->size -= iterator->second->payload->size();
+    this->entries.erase(iterator->second);
+    this->lookup.erase(iterator);
+  }
+
+  this->size += payload->size();
+  this->entries.push_front({key, std::move(payload)});
+  this->lookup[key] = this->entries.begin();
+  this->evict();
+}
+
+void libpak::payload_cache::set_budget(const uint64_t budget)
+{
+  std::scoped_lock lock(this->mutex);
+  this->budget = budget;
+  this->evict();
+}
+
+void libpak::payload_cache::clear() noexcept
+{
+  std::scoped_lock lock(this->mutex);
+  this->entries.clear();
+  this->lookup.clear();
+  this->size = 0;
+}
+
+libpak::cache_stats libpak::payload_cache::stats() const
+{
+  std::scoped_lock lock(this->mutex);
+  return {
+    .hits = this->hits,
+    .misses = this->misses,
+    .evictions = this->evictions,
+    .entries = this->entries.size(),
+    .size = this->size,
+    .budget = this->budget};
+}
+
+void libpak::payload_cache::evict()
+{
+  while (this->size > this->budget && !this->entries.empty())
+  {
+    const auto& victim = this->entries.back();
+    this->size -= victim.payload->size();
+    this->lookup.erase(victim.key);
+    this->entries.pop_back();
+    this->evictions++;
+  }
+}
@@ -0,0 +1,225 @@
+#include "libpak/codec.hpp"
+
+#include <array>
+#include <memory>
+#include <stdexcept>
+
+#include <zlib.h>
+
+#ifdef LIBPAK_WITH_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+namespace
+{
+
+class zlib_codec final : public libpak::codec
+{
+public:
+  [[nodiscard]] std::string_view name() const noexcept override
+  {
+    return "zlib";
+  }
+
+  [[nodiscard]] uint64_t compress_bound(const uint64_t size) const override
+  {
+    return compressBound(size);
+  }
+
+  uint64_t compress(
+    const std::span<const std::byte> data,
+    const std::span<std::byte> output,
+    const int level) const override
+  {
+    uLongf compressed_size = output.size();
+    const auto compression_result = compress2(
+      reinterpret_cast<Bytef*>(output.data()),
+      &compressed_size,
+      reinterpret_cast<const Bytef*>(data.data()),
+      data.size(),
+      level);
+    if (compression_result != Z_OK)
+      throw std::runtime_error("failed to compress asset data");
+    return compressed_size;
+  }
+
+  uint64_t decompress(
+    const std::span<const std::byte> data,
+    const std::span<std::byte> output) const override
+  {
+    uLongf decompressed_size = output.size();
+    uLong embedded_size = data.size();
+    const auto compression_result = uncompress2(
+      reinterpret_cast<Bytef*>(output.data()),
+      &decompressed_size,
+      reinterpret_cast<const Bytef*>(data.data()),
+      &embedded_size);
+
+    switch (compression_result)
+    {
+      case Z_BUF_ERROR:
+      case Z_MEM_ERROR:
+        throw std::runtime_error("not enough memory for uncompressed data");
+      case Z_DATA_ERROR:
+        throw std::runtime_error("corrupted compressed data");
+      default:
+        break;
+    }
+    return decompressed_size;
+  }
+};
+
+#ifdef LIBPAK_WITH_LIBDEFLATE
+
+class libdeflate_codec final : public libpak::codec
+{
+public:
+  [[nodiscard]] std::string_view name() const noexcept override
+  {
+    return "libdeflate";
+  }
+
+  [[nodiscard]] uint64_t compress_bound(const uint64_t size) const override
+  {
+    return libdeflate_zlib_compress_bound(compressor(MAX_LEVEL), size);
+  }
+
+  uint64_t compress(
+    const std::span<const std::byte> data,
+    const std::span<std::byte> output,
+    const int level) const override
+  {
+    const size_t compressed_size = libdeflate_zlib_compress(
+      compressor(level), data.data(), data.size(), output.data(), output.size());
+    if (compressed_size == 0)
+      throw std::runtime_error("failed to compress asset data");
+    return compressed_size;
+  }
+
+  uint64_t decompress(
+    const std::span<const std::byte> data,
+    const std::span<std::byte> output) const override
+  {
+    size_t decompressed_size = 0;
+    const auto decompression_result = libdeflate_zlib_decompress(
+      decompressor(), data.data(), data.size(), output.data(), output.size(), &decompressed_size);
+
+    switch (decompression_result)
+    {
+      case LIBDEFLATE_SUCCESS:
+        break;
+      case LIBDEFLATE_INSUFFICIENT_SPACE:
+        throw std::runtime_error("not enough memory for uncompressed data");
+      default:
+        throw std::runtime_error("corrupted compressed data");
+    }
+    return decompressed_size;
+  }
+
+private:
+  struct compressor_deleter
+  {
+    void operator()(libdeflate_compressor* compressor) const noexcept
+    {
+      libdeflate_free_compressor(compressor);
+    }
+  };
+
+  struct decompressor_deleter
+  {
+    void operator()(libdeflate_decompressor* decompressor) const noexcept
+    {
+      libdeflate_free_decompressor(decompressor);
+    }
+  };
+
+  //! Compression levels of zlib, libdeflate supports more.
+  static constexpr int MAX_LEVEL = 9;
+
+  /**
+   * (De)compressors can't be shared between threads, every thread
+   * allocates its own on the first use.
+   * @param level Compression level.
+   * @return Compressor of the calling thread.
+   */
+  static libdeflate_compressor* compressor(int level)
+  {
+    thread_local std::array<std::unique_ptr<libdeflate_compressor, compressor_deleter>, MAX_LEVEL + 1> compressors;
+
+    level = level < 1 ? 1 : level > MAX_LEVEL ? MAX_LEVEL : level;
+    auto& compressor = compressors[level];
+    if (compressor == nullptr)
+    {
+      compressor.reset(libdeflate_alloc_compressor(level));
+      if (compressor == nullptr)
+        throw std::runtime_error("failed to allocate compressor");
+    }
+    return compressor.get();
+  }
+
+  /**
+   * @return Decompressor of the calling thread.
+   */
+  static libdeflate_decompressor* decompressor()
+  {
+    thread_local std::unique_ptr<libdeflate_decompressor, decompressor_deleter> decompressor;
+
+    if (decompressor == nullptr)
+    {
+      decompressor.reset(libdeflate_alloc_decompressor());
+      if (decompressor == nullptr)
+        throw std::runtime_error("failed to allocate decompressor");
+    }
+    return decompressor.get();
+  }
+};
+
+#endif
+
+} // namespace
+
+bool libpak::is_codec_available(const codec_backend backend) noexcept
+{
+  switch (backend)
+  {
+    case codec_backend::zlib:
+      return true;
+    case codec_backend::libdeflate:
+#ifdef LIBPAK_WITH_LIBDEFLATE
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+libpak::codec_backend libpak::default_codec_backend() noexcept
+{
+#ifdef LIBPAK_WITH_LIBDEFLATE
+  return codec_backend::libdeflate;
+#else
+  return codec_backend::zlib;
+#endif
+}
+
+const libpak::codec& libpak::get_codec(const codec_backend backend)
+{
+  static const zlib_codec zlib;
+#ifdef LIBPAK_WITH_LIBDEFLATE
+  static const libdeflate_codec libdeflate;
+#endif
+
+  switch (backend)
+  {
+    case codec_backend::zlib:
+      return zlib;
+    case codec_backend::libdeflate:
+#ifdef LIBPAK_WITH_LIBDEFLATE
+      return libdeflate;
+#else
+      break;
+#endif
+  }
+  throw std::runtime_error("codec is not available");
+}
@@ -0,0 +1,82 @@
+#include "libpak/compact_index.hpp"
+
+void libpak::compact_index::reserve(const uint32_t count)
+{
+  this->path_offsets.reserve(count);
+  this->path_lengths.reserve(count);
+  this->embedded_data_offsets.reserve(count);
+  this->embedded_data_lengths.reserve(count);
+  this->data_decompressed_lengths.reserve(count);
+  this->crcs_embedded.reserve(count);
+  this->crcs_decompressed.reserve(count);
+  this->flags.reserve(count);
+}
+
+void libpak::compact_index::add(const asset_header& header)
+{
+  size_t path_length = 0;
+  while (path_length < std::size(header.path) && header.path[path_length] != u'\0')
+    ++path_length;
+
+  this->path_offsets.push_back(static_cast<uint32_t>(this->path_arena.size()));
+  this->path_lengths.push_back(static_cast<uint16_t>(path_length));
+  this->path_arena.append(header.path, path_length);
+
+  this->embedded_data_offsets.push_back(header.embedded_data_offset);
+  this->embedded_data_lengths.push_back(header.embedded_data_length);
+  this->data_decompressed_lengths.push_back(header.data_decompressed_length);
+  this->crcs_embedded.push_back(header.crc_embedded);
+  this->crcs_decompressed.push_back(header.crc_decompressed);
+
+  uint8_t asset_flags = 0;
+  if (header.is_asset_embedded)
+    asset_flags |= EMBEDDED;
+  if (header.is_data_compressed)
+    asset_flags |= COMPRESSED;
+  if (header.is_asset_deleted)
+    asset_flags |= DELETED;
+  this->flags.push_back(asset_flags);
+}
+
+void libpak::compact_index::build()
+{
+  this->path_arena.shrink_to_fit();
+  this->paths.build(this->size(), [this](const uint32_t entry) { return this->path(entry); });
+
+  // the entries of duplicate paths which the index does not lead to
+  if (this->paths.size() == this->size())
+    return;
+  for (uint32_t entry = 0; entry < this->size(); ++entry)
+  {
+    if (this->find(this->path(entry)) != entry)
+      this->flags[entry] |= SHADOWED;
+  }
+}
+
+void libpak::compact_index::clear() noexcept
+{
+  *this = {};
+}
+
+uint64_t libpak::compact_index::memory_usage() const noexcept
+{
+  return this->path_arena.capacity() * sizeof(char16_t)
+    + this->path_offsets.capacity() * sizeof(uint32_t)
+    + this->path_lengths.capacity() * sizeof(uint16_t)
+    + (this->embedded_data_offsets.capacity() + this->embedded_data_lengths.capacity()
+       + this->data_decompressed_lengths.capacity() + this->crcs_embedded.capacity()
+       + this->crcs_decompressed.capacity()) * sizeof(uint32_t)
+    + this->flags.capacity()
+    // the path index keeps the load factor at or below one half
+    + static_cast<uint64_t>(this->paths.size()) * 4 * sizeof(uint32_t);
+}
+
+std::optional<uint32_t> libpak::compact_index::find(const std::string_view path) const
+{
+  return this->paths.find(path, [this](const uint32_t entry) { return this->path(entry); });
+}
+
+std::optional<uint32_t> libpak::compact_index::find(const std::u16string_view path) const
+{
+  return this->paths.find(path, [this](const uint32_t entry) { return this->path(entry); });
+}
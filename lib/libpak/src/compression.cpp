@@ -0,0 +1,119 @@
+#include "libpak/compression.hpp"
+
+#include <algorithm>
+#include <format>
+#include <memory>
+
+std::string libpak::extension_of(const std::u16string_view path)
+{
+  const auto dot = path.find_last_of(u'.');
+  if (dot == std::u16string_view::npos)
+    return {};
+  // a dot in a directory name does not start an extension
+  const auto separator = path.find_last_of(u"/\\");
+  if (separator != std::u16string_view::npos && separator > dot)
+    return {};
+
+  std::string extension;
+  extension.reserve(path.size() - dot - 1);
+  for (const char16_t character : path.substr(dot + 1))
+  {
+    if (character >= u'A' && character <= u'Z')
+      extension.push_back(static_cast<char>(character - u'A' + 'a'));
+    else if (character < 0x80)
+      extension.push_back(static_cast<char>(character));
+    else
+      extension.push_back('?');
+  }
+  return extension;
+}
+
+int libpak::compression_policy::level(
+  const std::u16string_view path,
+  const uint64_t size) const
+{
+  int level = this->default_level;
+  if (this->rules.empty())
+    return level;
+
+  const auto extension = extension_of(path);
+  for (const auto& rule : this->rules)
+  {
+    if ((rule.extension.empty() || rule.extension == extension) && size >= rule.min_size)
+      level = rule.level;
+  }
+  return level;
+}
+
+bool libpak::compression_policy::is_compressible(
+  const std::span<const std::byte> data,
+  const codec& codec) const
+{
+  if (data.size() <= this->sample_size || this->sample_count == 0)
+    return true;
+
+  // samples spread over the data, headers of media files are often
+  // compressible while the rest is not
+  const uint64_t sample_length = this->sample_size / this->sample_count;
+  const uint64_t stride = (data.size() - sample_length) / std::max<uint32_t>(this->sample_count - 1, 1);
+
+  const uint64_t bound = codec.compress_bound(sample_length);
+  const auto buffer = std::make_unique_for_overwrite<std::byte[]>(bound);
+
+  uint64_t compressed_size = 0;
+  for (uint32_t sample = 0; sample < this->sample_count; ++sample)
+  {
+    compressed_size += codec.compress(
+      data.subspan(sample * stride, sample_length),
+      {buffer.get(), bound},
+      this->sample_level);
+  }
+  return this->is_worth_storing(sample_length * this->sample_count, compressed_size);
+}
+
+void libpak::compression_report::add(
+  const std::u16string_view path,
+  const uint64_t bytes_in,
+  const uint64_t bytes_out,
+  const bool stored_raw,
+  const std::chrono::nanoseconds compression_time)
+{
+  auto& entry = this->entries[extension_of(path)];
+  ++entry.assets;
+  entry.stored_raw += stored_raw;
+  entry.bytes_in += bytes_in;
+  entry.bytes_out += bytes_out;
+  entry.compression_time += compression_time;
+}
+
+std::string libpak::compression_report::to_string() const
+{
+  std::string report = std::format(
+    "{:<10} {:>10} {:>10} {:>14} {:>14} {:>14} {:>12}\n",
+    "extension", "assets", "raw", "bytes in", "bytes out", "bytes saved", "cpu ms");
+
+  const auto append = [&report](const std::string_view name, const entry& entry) {
+    report += std::format(
+      "{:<10} {:>10} {:>10} {:>14} {:>14} {:>14} {:>12.1f}\n",
+      name,
+      entry.assets,
+      entry.stored_raw,
+      entry.bytes_in,
+      entry.bytes_out,
+      static_cast<int64_t>(entry.bytes_in) - static_cast<int64_t>(entry.bytes_out),
+      std::chrono::duration<double, std::milli>(entry.compression_time).count());
+  };
+
+  entry total;
+  for (const auto& [extension, entry] : this->entries)
+  {
+    append(extension.empty() ? "(none)" : extension, entry);
+    total.assets += entry.assets;
+    total.stored_raw += entry.stored_raw;
+    total.bytes_in += entry.bytes_in;
+    total.bytes_out += entry.bytes_out;
+    total.compression_time += entry.compression_time;
+  }
+  append("total", total);
+  return report;
+}
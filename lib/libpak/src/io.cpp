@@ -0,0 +1,511 @@
+#include "libpak/io.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <format>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+libpak::file::file(const std::string& path, const file_mode mode)
+{
+  int flags = O_CLOEXEC;
+  switch (mode)
+  {
+    case file_mode::read:
+      flags |= O_RDONLY;
+      break;
+    case file_mode::read_write:
+      flags |= O_RDWR;
+      break;
+    case file_mode::create:
+      flags |= O_RDWR | O_CREAT | O_TRUNC;
+      break;
+  }
+
+  this->file_descriptor = ::open(path.c_str(), flags, 0644);
+  if (this->file_descriptor < 0)
+    throw std::runtime_error(std::format("failed to open '{}'", path));
+}
+
+libpak::file::~file() noexcept
+{
+  if (this->file_descriptor >= 0)
+    ::close(this->file_descriptor);
+}
+
+bool libpak::file::read_at(std::byte* buffer, uint64_t size, uint64_t offset) const noexcept
+{
+  // pread may return less than requested, keep reading until done
+  while (size != 0)
+  {
+    const ssize_t result = ::pread(this->file_descriptor, buffer, size, static_cast<off_t>(offset));
+    if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    // unexpected end of file
+    if (result == 0)
+      return false;
+
+    buffer += result;
+    size -= result;
+    offset += result;
+  }
+  return true;
+}
+
+bool libpak::file::write_at(const std::byte* buffer, uint64_t size, uint64_t offset) const noexcept
+{
+  // pwrite may write less than requested, keep writing until done
+  while (size != 0)
+  {
+    const ssize_t result = ::pwrite(this->file_descriptor, buffer, size, static_cast<off_t>(offset));
+    if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+
+    buffer += result;
+    size -= result;
+    offset += result;
+  }
+  return true;
+}
+
+bool libpak::file::sync() const noexcept
+{
+  return ::fdatasync(this->file_descriptor) == 0;
+}
+
+uint64_t libpak::file::size() const noexcept
+{
+  struct stat status{};
+  if (::fstat(this->file_descriptor, &status) != 0)
+    return 0;
+  return status.st_size;
+}
+
+libpak::mapped_file::mapped_file(const std::string& path)
+{
+  const int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (descriptor < 0)
+    throw std::runtime_error(std::format("failed to open '{}' for mapping", path));
+
+  struct stat status{};
+  if (::fstat(descriptor, &status) != 0)
+  {
+    ::close(descriptor);
+    throw std::runtime_error(std::format("failed to stat '{}'", path));
+  }
+
+  this->mapping_size = status.st_size;
+  if (this->mapping_size != 0)
+  {
+    void* const mapping = ::mmap(
+      nullptr, this->mapping_size, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (mapping == MAP_FAILED)
+    {
+      ::close(descriptor);
+      throw std::runtime_error(std::format("failed to map '{}'", path));
+    }
+    this->mapping = static_cast<const std::byte*>(mapping);
+  }
+
+  // the mapping stays valid after the descriptor is closed
+  ::close(descriptor);
+}
+
+libpak::mapped_file::~mapped_file() noexcept
+{
+  if (this->mapping != nullptr)
+    ::munmap(const_cast<std::byte*>(this->mapping), this->mapping_size);
+}
+
+std::span<const std::byte> libpak::mapped_file::view(const uint64_t offset, const uint64_t length) const
+{
+  if (!this->contains(offset, length))
+    throw std::runtime_error("mapped range is out of bounds");
+  return {this->mapping + offset, length};
+}
+
+void libpak::mapped_file::prefetch(const uint64_t offset, const uint64_t length) const noexcept
+{
+  if (this->mapping == nullptr || !this->contains(offset, length))
+    return;
+
+  // madvise requires a page aligned address
+  const auto page_size = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+  const uint64_t aligned_offset = offset - offset % page_size;
+  ::madvise(
+    const_cast<std::byte*>(this->mapping) + aligned_offset,
+    length + (offset - aligned_offset),
+    MADV_WILLNEED);
+}
+
+libpak::io_ring::io_ring(const uint32_t entries)
+{
+#ifdef __linux__
+  io_uring_params params{};
+  this->ring_descriptor = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+  if (this->ring_descriptor < 0)
+    throw std::runtime_error("io_uring is not available");
+
+  // kernels before 5.6 have the ring but not the read operation, nor the probe
+  constexpr size_t probe_size = sizeof(io_uring_probe) + (IORING_OP_READ + 1) * sizeof(io_uring_probe_op);
+  alignas(io_uring_probe) std::byte probe_storage[probe_size]{};
+  auto* const probe = reinterpret_cast<io_uring_probe*>(probe_storage);
+  const auto probed = ::syscall(
+    __NR_io_uring_register, this->ring_descriptor, IORING_REGISTER_PROBE, probe, IORING_OP_READ + 1);
+  if (probed < 0
+    || probe->last_op < IORING_OP_READ
+    || (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) == 0)
+  {
+    this->release();
+    throw std::runtime_error("io_uring read is not available");
+  }
+
+  this->submission_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  this->completion_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  // both rings may share a single mapping
+  const bool single_mapping = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mapping)
+  {
+    this->submission_ring_size = std::max(this->submission_ring_size, this->completion_ring_size);
+    this->completion_ring_size = 0;
+  }
+
+  const auto map_ring = [this](const size_t size, const off_t offset) -> void* {
+    void* const mapping = ::mmap(
+      nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_descriptor, offset);
+    return mapping == MAP_FAILED ? nullptr : mapping;
+  };
+
+  this->submission_ring = map_ring(this->submission_ring_size, IORING_OFF_SQ_RING);
+  this->completion_ring = single_mapping
+    ? this->submission_ring
+    : map_ring(this->completion_ring_size, IORING_OFF_CQ_RING);
+  this->submission_entries_size = params.sq_entries * sizeof(io_uring_sqe);
+  this->submission_entries = map_ring(this->submission_entries_size, IORING_OFF_SQES);
+  if (this->submission_ring == nullptr || this->completion_ring == nullptr || this->submission_entries == nullptr)
+  {
+    this->release();
+    throw std::runtime_error("failed to map io_uring");
+  }
+
+  auto* const submission = static_cast<std::byte*>(this->submission_ring);
+  this->submission_head = reinterpret_cast<uint32_t*>(submission + params.sq_off.head);
+  this->submission_tail = reinterpret_cast<uint32_t*>(submission + params.sq_off.tail);
+  this->submission_array = reinterpret_cast<uint32_t*>(submission + params.sq_off.array);
+  this->submission_mask = *reinterpret_cast<uint32_t*>(submission + params.sq_off.ring_mask);
+  this->submission_capacity = params.sq_entries;
+
+  auto* const completion = static_cast<std::byte*>(this->completion_ring);
+  this->completion_head = reinterpret_cast<uint32_t*>(completion + params.cq_off.head);
+  this->completion_tail = reinterpret_cast<uint32_t*>(completion + params.cq_off.tail);
+  this->completion_entries = completion + params.cq_off.cqes;
+  this->completion_mask = *reinterpret_cast<uint32_t*>(completion + params.cq_off.ring_mask);
+#else
+  throw std::runtime_error("io_uring is not available");
+#endif
+}
+
+libpak::io_ring::~io_ring() noexcept
+{
+  this->release();
+}
+
+void libpak::io_ring::release() noexcept
+{
+  if (this->submission_entries != nullptr)
+    ::munmap(this->submission_entries, this->submission_entries_size);
+  if (this->completion_ring != nullptr && this->completion_ring != this->submission_ring)
+    ::munmap(this->completion_ring, this->completion_ring_size);
+  if (this->submission_ring != nullptr)
+    ::munmap(this->submission_ring, this->submission_ring_size);
+  if (this->ring_descriptor >= 0)
+    ::close(this->ring_descriptor);
+
+  this->submission_entries = nullptr;
+  this->completion_ring = nullptr;
+  this->submission_ring = nullptr;
+  this->ring_descriptor = -1;
+}
+
+bool libpak::io_ring::prepare_read(
+  const file& input,
+  std::byte* buffer,
+  const uint32_t size,
+  const uint64_t offset,
+  const uint64_t user_data) noexcept
+{
+#ifdef __linux__
+  // the kernel consumes the submission queue from its head
+  const uint32_t tail = *this->submission_tail;
+  const uint32_t head = std::atomic_ref(*this->submission_head).load(std::memory_order_acquire);
+  if (tail - head >= this->submission_capacity)
+    return false;
+
+  const uint32_t index = tail & this->submission_mask;
+  auto& entry = static_cast<io_uring_sqe*>(this->submission_entries)[index];
+  entry = {};
+  entry.opcode = IORING_OP_READ;
+  entry.fd = input.descriptor();
+  entry.addr = reinterpret_cast<uint64_t>(buffer);
+  entry.len = size;
+  entry.off = offset;
+  entry.user_data = user_data;
+  this->submission_array[index] = index;
+
+  // publish the entry
+  std::atomic_ref(*this->submission_tail).store(tail + 1, std::memory_order_release);
+  this->prepared++;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool libpak::io_ring::submit() noexcept
+{
+#ifdef __linux__
+  while (this->prepared != 0)
+  {
+    const auto result = ::syscall(__NR_io_uring_enter, this->ring_descriptor, this->prepared, 0, 0, nullptr, 0);
+    if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    this->prepared -= static_cast<uint32_t>(result);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+libpak::io_ring::completion libpak::io_ring::wait()
+{
+#ifdef __linux__
+  while (true)
+  {
+    const uint32_t head = *this->completion_head;
+    const uint32_t tail = std::atomic_ref(*this->completion_tail).load(std::memory_order_acquire);
+    if (head != tail)
+    {
+      const auto& entry = static_cast<const io_uring_cqe*>(this->completion_entries)[head & this->completion_mask];
+      const completion completed{entry.user_data, entry.res};
+      // hand the entry back to the kernel
+      std::atomic_ref(*this->completion_head).store(head + 1, std::memory_order_release);
+      return completed;
+    }
+
+    const auto result = ::syscall(
+      __NR_io_uring_enter, this->ring_descriptor, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    if (result < 0 && errno != EINTR)
+      throw std::runtime_error("failed to wait for io_uring completion");
+  }
+#else
+  throw std::runtime_error("io_uring is not available");
+#endif
+}
+
+namespace
+{
+
+//! Alignment of the write buffers, the size of a page.
+constexpr std::align_val_t WRITE_BUFFER_ALIGNMENT{4096};
+
+/**
+ * Writes the vectors to the file at the offset.
+ * @param descriptor Native file descriptor.
+ * @param vectors    Vectors, consumed by the write.
+ * @param count      Count of vectors.
+ * @param offset     Offset.
+ * @param statistics Statistics to update.
+ * @return True if all vectors were written, otherwise returns false.
+ */
+bool write_vectors(
+  const int descriptor,
+  iovec* vectors,
+  int count,
+  uint64_t offset,
+  libpak::write_stats& statistics) noexcept
+{
+  // pwritev may write less than requested, keep writing until done
+  while (count != 0)
+  {
+    ssize_t result = ::pwritev(descriptor, vectors, count, static_cast<off_t>(offset));
+    ++statistics.syscalls;
+    if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+
+    statistics.bytes += result;
+    offset += result;
+
+    // drop the written vectors
+    while (count != 0 && static_cast<size_t>(result) >= vectors->iov_len)
+    {
+      result -= static_cast<ssize_t>(vectors->iov_len);
+      ++vectors;
+      --count;
+    }
+    if (count != 0)
+    {
+      vectors->iov_base = static_cast<std::byte*>(vectors->iov_base) + result;
+      vectors->iov_len -= result;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+void libpak::buffered_writer::buffer_deleter::operator()(std::byte* buffer) const noexcept
+{
+  ::operator delete(buffer, WRITE_BUFFER_ALIGNMENT);
+}
+
+libpak::buffered_writer::buffered_writer(
+  const file& output,
+  const uint64_t offset,
+  const size_t capacity)
+  : output(output)
+  , buffer(static_cast<std::byte*>(::operator new(capacity, WRITE_BUFFER_ALIGNMENT)))
+  , buffer_capacity(capacity)
+  , buffer_offset(offset)
+{
+}
+
+bool libpak::buffered_writer::write(const std::byte* data, uint64_t size) noexcept
+{
+  if (size <= this->buffer_capacity - this->buffer_size)
+  {
+    std::memcpy(this->buffer.get() + this->buffer_size, data, size);
+    this->buffer_size += size;
+    return true;
+  }
+
+  // data larger than the buffer is written right away, with the buffered data
+  if (size >= this->buffer_capacity)
+  {
+    iovec vectors[2]{
+      {this->buffer.get(), this->buffer_size},
+      {const_cast<std::byte*>(data), size}};
+    if (!write_vectors(this->output.descriptor(), vectors, 2, this->buffer_offset, this->statistics))
+      return false;
+
+    this->buffer_offset += this->buffer_size + size;
+    this->buffer_size = 0;
+    return true;
+  }
+
+  // fill the buffer up, flush it and buffer the rest
+  const uint64_t head = this->buffer_capacity - this->buffer_size;
+  std::memcpy(this->buffer.get() + this->buffer_size, data, head);
+  this->buffer_size += head;
+  if (!this->flush())
+    return false;
+
+  std::memcpy(this->buffer.get(), data + head, size - head);
+  this->buffer_size = size - head;
+  return true;
+}
+
+bool libpak::buffered_writer::skip(const uint64_t length) noexcept
+{
+  if (!this->flush())
+    return false;
+  this->buffer_offset += length;
+  return true;
+}
+
+bool libpak::buffered_writer::flush() noexcept
+{
+  if (this->buffer_size == 0)
+    return true;
+
+  iovec vector{this->buffer.get(), this->buffer_size};
+  if (!write_vectors(this->output.descriptor(), &vector, 1, this->buffer_offset, this->statistics))
+    return false;
+
+  this->buffer_offset += this->buffer_size;
+  this->buffer_size = 0;
+  return true;
+}
+
+bool libpak::copy_range(
+  const file& source,
+  uint64_t source_offset,
+  const file& destination,
+  uint64_t destination_offset,
+  uint64_t length) noexcept
+{
+#ifdef __linux__
+  while (length != 0)
+  {
+    auto input_offset = static_cast<loff_t>(source_offset);
+    auto output_offset = static_cast<loff_t>(destination_offset);
+    const ssize_t result = ::copy_file_range(
+      source.descriptor(), &input_offset,
+      destination.descriptor(), &output_offset,
+      length, 0);
+    if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      // not supported between these files, copy through user space
+      if (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)
+        break;
+      return false;
+    }
+    // unexpected end of file
+    if (result == 0)
+      return false;
+
+    source_offset += result;
+    destination_offset += result;
+    length -= result;
+  }
+
+  if (length == 0)
+    return true;
+#endif
+
+  constexpr uint64_t buffer_size = 1024 * 1024;
+  const auto buffer = std::make_unique_for_overwrite<std::byte[]>(std::min(length, buffer_size));
+  while (length != 0)
+  {
+    const uint64_t chunk = std::min(length, buffer_size);
+    if (!source.read_at(buffer.get(), chunk, source_offset)
+      || !destination.write_at(buffer.get(), chunk, destination_offset))
+      return false;
+
+    source_offset += chunk;
+    destination_offset += chunk;
+    length -= chunk;
+  }
+  return true;
+}
@@ -4,34 +4,194 @@
 
 #include "libpak/libpak.hpp"
 #include "libpak/algorithms.hpp"
+#include "libpak/codec.hpp"
+#include "libpak/concurrency.hpp"
 #include "libpak/util.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <cstdio>
+#include <exception>
+#include <filesystem>
 #include <format>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <ranges>
 #include <stdexcept>
-
-#include <zlib.h>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 
 namespace
 {
 
 /**
- * Calculate buffer's alicia checksum.
- * @param buffer Buffer
- * @param length Length
- * @return Checksum
+ * Inflate asset's embedded data.
+ * @param header        Asset header.
+ * @param embedded_data Embedded data.
+ * @param codec         Codec.
+ * @param data          Asset data to inflate into.
+ * @throws std::runtime_error
  */
-int32_t alicia_checksum(const char* buffer, uint64_t length)
+void inflate_data(
+  const libpak::asset_header& header,
+  const std::span<const std::byte> embedded_data,
+  const libpak::codec& codec,
+  libpak::asset_data& data)
 {
-  int32_t result = 0;
-  do
+  // NPAK can compress small buffers and inflate them. Because to this,
+  // choose the largest data size for the decompressed data buffer.
+  const uint64_t decompressed_data_size = std::max(
+    header.embedded_data_length,
+    header.data_decompressed_length);
+
+  // allocate uninitialized buffer for data, the inflate overwrites it
+  std::shared_ptr<std::byte[]> buffer;
+  try
   {
-    result += *buffer;
-    buffer++;
-    length--;
-  } while (length != 0);
-  return result;
+    buffer = std::make_shared_for_overwrite<std::byte[]>(decompressed_data_size);
+  }
+  catch (std::bad_alloc& alloc)
+  {
+    throw std::runtime_error("not enough memory for data buffer");
+  }
+
+  // uncompress
+  const uint64_t decompressed_size = codec.decompress(
+    embedded_data, {buffer.get(), decompressed_data_size});
+  const std::span<const std::byte> decompressed_view{buffer.get(), decompressed_size};
+  data.load(decompressed_view, std::move(buffer));
+}
+
+//! Count of asset headers read at once, roughly 4 MiB worth.
+constexpr uint32_t ASSET_HEADERS_CHUNK = 4 * 1024 * 1024 / sizeof(libpak::asset_header);
+
+//! Identifies payloads which are candidates for deduplication.
+struct payload_key
+{
+  uint32_t crc_decompressed;
+  uint32_t crc_embedded;
+  uint64_t decompressed_length;
+  uint64_t embedded_length;
+  bool compressed;
+
+  bool operator==(const payload_key&) const = default;
+};
+
+struct payload_key_hash
+{
+  size_t operator()(const payload_key& key) const noexcept
+  {
+    const uint64_t crcs = static_cast<uint64_t>(key.crc_decompressed) << 32 | key.crc_embedded;
+    return crcs ^ (key.embedded_length * 0x9E3779B97F4A7C15) ^ key.compressed;
+  }
+};
+
+//! Payload written to the output, a candidate for deduplication.
+struct written_payload
+{
+  const libpak::asset* asset;
+  //! Whether the payload was encoded, so its data is at hand for comparison.
+  bool encoded;
+};
+
+//! Extent of embedded data in a source resource.
+using source_extent = std::tuple<const libpak::resource*, uint32_t, uint32_t>;
+
+/**
+ * @return Decompressed data of the asset, as encoded for writing.
+ */
+std::span<const std::byte> encoded_payload(const libpak::asset& asset) noexcept
+{
+  return asset.data.bytes().first(
+    std::min<size_t>(asset.data.size(), asset.header.data_decompressed_length));
+}
+
+/**
+ * Accounts the encoded asset in the report, before its header is updated.
+ * @param report  Compression report.
+ * @param asset   Asset.
+ * @param encoded Encoded asset.
+ */
+void report_compression(
+  libpak::compression_report& report,
+  const libpak::asset& asset,
+  const libpak::encoded_asset& encoded)
+{
+  report.add(
+    asset.path_view(),
+    encoded_payload(asset).size(),
+    encoded.embedded_data.size(),
+    asset.header.is_data_compressed && not encoded.compressed,
+    encoded.compression_time);
+}
+
+//! Largest gap between the data of two assets read as one extent.
+constexpr uint64_t EXTENT_MAX_GAP = 64 * 1024;
+//! Largest extent, unless the data of a single asset is larger.
+constexpr uint64_t EXTENT_MAX_SIZE = 2 * 1024 * 1024;
+
+//! Range of the resource read at once, covering the data of one or more assets.
+struct read_extent
+{
+  uint64_t offset;
+  uint64_t size;
+  //! Assets whose data lies in the extent, a range of the sorted batch.
+  size_t first_asset;
+  size_t last_asset;
+};
+
+/**
+ * Merges the embedded data of the assets into extents.
+ * @param assets Assets sorted by their data offset.
+ * @return Extents in the order of the data.
+ */
+std::vector<read_extent> merge_extents(const std::span<libpak::asset* const> assets)
+{
+  std::vector<read_extent> extents;
+  for (size_t index = 0; index < assets.size(); ++index)
+  {
+    const auto& header = assets[index]->header;
+    const uint64_t begin = header.embedded_data_offset;
+    const uint64_t end = begin + header.embedded_data_length;
+
+    if (!extents.empty())
+    {
+      auto& extent = extents.back();
+      const uint64_t extent_end = extent.offset + extent.size;
+      // deduplicated assets share their data, so the extents may overlap
+      if (begin <= extent_end + EXTENT_MAX_GAP && end - extent.offset <= EXTENT_MAX_SIZE)
+      {
+        extent.size = std::max(extent_end, end) - extent.offset;
+        extent.last_asset = index + 1;
+        continue;
+      }
+    }
+    extents.push_back({begin, end - begin, index, index + 1});
+  }
+  return extents;
+}
+
+/**
+ * Allocates an uninitialized buffer for an extent.
+ * @param size Size of the extent.
+ * @throws std::runtime_error
+ * @return Buffer.
+ */
+std::shared_ptr<std::byte[]> allocate_extent(const uint64_t size)
+{
+  try
+  {
+    return std::make_shared_for_overwrite<std::byte[]>(size);
+  }
+  catch (std::bad_alloc& alloc)
+  {
+    throw std::runtime_error("not enough memory for extent buffer");
+  }
 }
 
 } // namespace
@@ -127,53 +287,95 @@ libpak::stream::stream(
 
 void libpak::resource::create() {}
 
-void libpak::resource::read(const bool data)
+void libpak::resource::open()
 {
-  // input stream
-  this->input_stream = std::make_shared<std::ifstream>(
-    this->resource_path, std::ios::binary);
-  // resource stream wrapper
-  this->resource_stream = std::make_shared<stream>(
-    this->input_stream, this->output_stream);
+  if (this->resource_backend == backend::mapped)
+  {
+    // resource mapping
+    this->resource_mapping = std::make_shared<mapped_file>(this->resource_path);
+    this->resource_file.reset();
+
+    // read the intro header
+    if (!this->resource_mapping->read(this->pak_header, 0))
+      throw std::runtime_error("failed to read pak header");
+
+    // read the content header
+    if (!this->resource_mapping->read(this->content_header, PAK_CONTENT_SECTOR))
+      throw std::runtime_error("failed to read content header");
+
+    // fault in the whole header table ahead of the parsing
+    this->resource_mapping->prefetch(
+      PAK_ASSET_HEADERS_SECTOR,
+      static_cast<uint64_t>(this->content_header.assets_count) * sizeof(asset_header));
+  }
+  else
+  {
+    // positional reader
+    this->resource_file = std::make_shared<file>(this->resource_path);
+    this->resource_mapping.reset();
 
-  // reset to known state
-  this->resource_stream->set_reader_cursor(0);
+    // read the intro header
+    if (!this->resource_file->read_at(this->pak_header, 0))
+      throw std::runtime_error("failed to read pak header");
 
-  // read the intro header
-  if (!this->resource_stream->read(this->pak_header))
-    throw std::runtime_error("failed to read pak header");
+    // read the content header
+    if (!this->resource_file->read_at(this->content_header, PAK_CONTENT_SECTOR))
+      throw std::runtime_error("failed to read content header");
+  }
 
-  // read the content header
-  this->resource_stream->set_reader_cursor(PAK_CONTENT_SECTOR);
-  if (!this->resource_stream->read(this->content_header))
-    throw std::runtime_error("failed to read content header");
+  // payloads of the previous read are stale
+  this->cache.clear();
+}
+
+void libpak::resource::read(const bool data)
+{
+  this->open();
 
   // reserve the size of asset count
   this->assets.reserve(this->content_header.assets_count);
 
-  // read the assets
-  for (uint32_t assetIndex{0}; assetIndex < content_header.assets_count; assetIndex++)
-  {
-    try
-    {
-      asset asset;
+  // read the asset headers in large chunks and decode them in memory
+  std::vector<asset_header> header_chunk(
+    std::min<uint32_t>(this->content_header.assets_count, ASSET_HEADERS_CHUNK));
 
-      // read asset
-      this->read_asset_header(asset);
+  for (uint32_t chunkIndex{0}; chunkIndex < content_header.assets_count;
+       chunkIndex += ASSET_HEADERS_CHUNK)
+  {
+    const auto chunk = std::span(header_chunk).first(
+      std::min<uint32_t>(content_header.assets_count - chunkIndex, ASSET_HEADERS_CHUNK));
+    this->read_asset_headers(chunkIndex, chunk);
 
-      // read the asset data
+    for (const auto& header : chunk)
+    {
       try
       {
-        if (data)
-          this->read_asset_data(asset);
+        asset asset;
+        asset.header = header;
+        asset.source = this;
+        asset.header_index = static_cast<uint32_t>(chunkIndex + (&header - chunk.data()));
+
+        // handle invalid asset
+        if (asset.header.asset_magic == 0x0)
+          throw std::runtime_error("invalid asset header read");
+
+        // index asset
+        this->assets[asset.path()] = std::move(asset);
       }
-      catch (const std::runtime_error& err)
+      catch (const std::runtime_error& e)
       {
-        throw std::runtime_error(std::format("failed read asset data: {}", err.what()));
+        throw std::runtime_error(std::format("failed to read asset: {}", e.what()));
       }
+    }
+  }
+
+  this->reindex();
 
-      // index asset
-      this->assets[asset.path()] = std::move(asset);
+  // read the asset data
+  if (data)
+  {
+    try
+    {
+      this->read_all_asset_data();
     }
     catch (const std::runtime_error& e)
     {
@@ -184,220 +386,1067 @@ void libpak::resource::read(const bool data)
 
 void libpak::resource::write()
 {
-  // input stream
-  this->output_stream = std::make_shared<std::ofstream>(
-    this->resource_path, std::ios::binary);
-  // resource stream wrapper
-  this->resource_stream = std::make_shared<stream>(
-    this->input_stream, this->output_stream);
+  this->write(this->resource_path);
+}
 
-  this->resource_stream->set_writer_cursor(0);
+void libpak::resource::write(const std::string& path)
+{
+  std::vector<asset*> ordered_assets;
+  ordered_assets.reserve(this->assets.size());
+  for (auto& asset : this->assets | std::views::values)
+    ordered_assets.push_back(&asset);
+
+  // an untouched asset is copied through from its source resource as is
+  const auto copies_through = [](const asset& asset) {
+    return not asset.isPatched()
+      && asset.source != nullptr
+      && asset.header_index != asset::UNINDEXED
+      && asset.header.is_asset_embedded
+      && (asset.source->resource_file != nullptr || asset.source->resource_mapping != nullptr);
+  };
+
+  // the resource is written to a temporary file which replaces the output
+  // once complete, the assets may copy or borrow their data from the output
+  const std::string output_path = path + ".tmp";
+  const file output(output_path, file_mode::create);
+
+  const auto assets_count = static_cast<uint32_t>(ordered_assets.size());
+  const uint64_t header_table_end = PAK_ASSET_HEADERS_SECTOR
+    + static_cast<uint64_t>(assets_count) * sizeof(asset_header);
+  // the data follows the header table once it outgrows the default sector
+  const uint64_t data_sector = std::max<uint64_t>(
+    PAK_DATA_SECTOR, header_table_end + sizeof(struct data_header));
+
+  // the header table is assembled in memory and written once at the end,
+  // the data is streamed sequentially through the buffered writer
+  std::vector<asset_header> header_table(assets_count);
+  buffered_writer data_writer(output, data_sector);
+
+  // the payloads written so far, by their digest, and the offsets of the
+  // extents copied through so far, when deduplicating
+  std::unordered_map<payload_key, written_payload, payload_key_hash> written_payloads;
+  std::map<source_extent, uint32_t> copied_extents;
+  this->dedup_statistics = {};
+  this->compression_report = {};
+  const auto share = [this](asset_header& header, const uint32_t offset) {
+    header.embedded_data_offset = offset;
+    ++this->dedup_statistics.assets;
+    this->dedup_statistics.bytes_saved += header.embedded_data_length;
+  };
+
+  // compares embedded data against the embedded data written for the asset
+  const auto written_equals = [&](const asset& written, const std::span<const std::byte> embedded_data) {
+    if (written.header.embedded_data_length != embedded_data.size())
+      return false;
+    if (!data_writer.flush())
+      throw std::runtime_error("failed to write asset data");
+    const auto written_data = this->scratch.acquire(embedded_data.size());
+    if (!output.read_at(written_data.data(), written_data.size(), written.header.embedded_data_offset))
+      throw std::runtime_error("failed to read written asset data");
+    return std::ranges::equal(written_data.span(), embedded_data);
+  };
+
+  // workers compress and hash the assets, while the calling thread
+  // writes them in order, so the output is deterministic
+  const auto& codec = get_codec(this->compression_backend);
+  const unsigned workers_count = resolve_worker_count(this->worker_count);
+  ordered_pipeline<encoded_asset>(
+    ordered_assets.size(),
+    workers_count,
+    workers_count * 4,
+    [&](const size_t index) {
+      const auto& asset = *ordered_assets[index];
+      if (copies_through(asset))
+        return encoded_asset{.copy_through = true};
+      return this->encode_asset_data(asset, codec, this->compression_policy.get(), &this->scratch);
+    },
+    [&](const size_t index, encoded_asset&& encoded) {
+      auto& asset = *ordered_assets[index];
+      const uint64_t data_offset = data_writer.offset();
+
+      if (encoded.copy_through)
+      {
+        // the CRCs and checksums of the copied data stay valid
+        const auto& source = *asset.source;
+        const uint32_t length = asset.header.embedded_data_length;
+
+        // extents already shared in the source are shared in the output as well,
+        // other candidates found by the digests of the header are compared
+        const source_extent extent{&source, asset.header.embedded_data_offset, length};
+        const auto copied_extent = this->deduplicate
+          ? copied_extents.find(extent)
+          : copied_extents.end();
+        const libpak::asset* original = nullptr;
+        if (this->deduplicate && copied_extent == copied_extents.end())
+        {
+          const payload_key key{
+            .crc_decompressed = asset.header.crc_decompressed,
+            .crc_embedded = asset.header.crc_embedded,
+            .decompressed_length = asset.header.data_decompressed_length,
+            .embedded_length = length,
+            .compressed = static_cast<bool>(asset.header.is_data_compressed)};
+          const auto [written, inserted] = written_payloads.try_emplace(
+            key, written_payload{.asset = &asset, .encoded = false});
+          if (!inserted)
+          {
+            const bool equal = source.resource_mapping != nullptr
+              ? written_equals(*written->second.asset, source.view_asset_data(asset))
+              : written_equals(*written->second.asset, source.read_embedded_data(asset).span());
+            if (equal)
+              original = written->second.asset;
+          }
+        }
+
+        if (copied_extent != copied_extents.end())
+        {
+          share(asset.header, copied_extent->second);
+        }
+        else if (original != nullptr)
+        {
+          share(asset.header, original->header.embedded_data_offset);
+          copied_extents.emplace(extent, asset.header.embedded_data_offset);
+        }
+        else
+        {
+          if (data_offset + length > UINT32_MAX)
+            throw std::runtime_error("resource is too large");
+
+          bool copied;
+          if (source.resource_mapping != nullptr)
+          {
+            copied = data_writer.write(source.view_asset_data(asset).data(), length);
+          }
+          else
+          {
+            copied = data_writer.flush()
+              && copy_range(*source.resource_file, asset.header.embedded_data_offset, output, data_offset, length)
+              && data_writer.skip(length);
+          }
+          if (!copied)
+            throw std::runtime_error("failed to copy asset data");
+
+          asset.header.embedded_data_offset = static_cast<uint32_t>(data_offset);
+          if (this->deduplicate)
+            copied_extents.emplace(extent, asset.header.embedded_data_offset);
+        }
+      }
+      else if (encoded.has_data)
+      {
+        report_compression(this->compression_report, asset, encoded);
+
+        // identical payloads encode to identical data, the digests only find
+        // the candidates and the payloads themselves are compared
+        const libpak::asset* original = nullptr;
+        if (this->deduplicate)
+        {
+          const payload_key key{
+            .crc_decompressed = encoded.crc_decompressed,
+            .crc_embedded = encoded.crc_embedded,
+            .decompressed_length = encoded_payload(asset).size(),
+            .embedded_length = encoded.embedded_data.size(),
+            .compressed = encoded.compressed};
+          const auto [written, inserted] = written_payloads.try_emplace(
+            key, written_payload{.asset = &asset, .encoded = true});
+          if (!inserted)
+          {
+            const bool equal = written->second.encoded
+              ? std::ranges::equal(encoded_payload(*written->second.asset), encoded_payload(asset))
+              : written_equals(*written->second.asset, encoded.embedded_data);
+            if (equal)
+              original = written->second.asset;
+          }
+        }
+
+        if (original != nullptr)
+        {
+          encoded.apply(asset.header, original->header.embedded_data_offset);
+          share(asset.header, original->header.embedded_data_offset);
+        }
+        else
+        {
+          if (data_offset + encoded.embedded_data.size() > UINT32_MAX)
+            throw std::runtime_error("resource is too large");
+          if (!data_writer.write(encoded.embedded_data.data(), encoded.embedded_data.size()))
+            throw std::runtime_error("failed to write asset data");
+          encoded.apply(asset.header, static_cast<uint32_t>(data_offset));
+        }
+      }
+
+      asset.header_index = static_cast<uint32_t>(index);
+      asset.clearPatched();
+      header_table[index] = asset.header;
+    });
+
+  if (!data_writer.flush())
+    throw std::runtime_error("failed to write asset data");
 
   // Update the content header
-  this->content_header.assets_count = this->assets.size();
+  this->content_header.assets_count = assets_count;
+
+  // the content header, the header table and the data header are contiguous
+  buffered_writer header_writer(output, PAK_CONTENT_SECTOR);
+  if (!header_writer.write(this->content_header)
+    || !header_writer.write(
+      reinterpret_cast<const std::byte*>(header_table.data()),
+      header_table.size() * sizeof(asset_header))
+    || !header_writer.write(this->data_header)
+    || !header_writer.flush())
+    throw std::runtime_error("failed to write asset headers");
 
-  // write the content header
-  this->resource_stream->set_writer_cursor(PAK_CONTENT_SECTOR);
-  if (!this->resource_stream->write(this->content_header))
-    throw std::runtime_error("failed to write content header");
+  // Update the intro PAKS header assets counts
+  this->pak_header.assets_count = assets_count;
+  this->pak_header.used_assets_count = assets_count;
+  this->pak_header.deleted_assets_count = 0;
+
+  this->pak_header.file_size = header_table_end + sizeof(struct data_header);
+
+  // Write the intro PAKS header
+  if (!output.write_at(this->pak_header, 0))
+    throw std::runtime_error("failed to write pak header");
 
-  int64_t data_offset = PAK_DATA_SECTOR;
+  this->write_statistics = data_writer.stats();
+  this->write_statistics += header_writer.stats();
+  this->write_statistics += write_stats{.syscalls = 1, .bytes = sizeof(struct pak_header)};
+
+  std::filesystem::rename(output_path, path);
+
+  // the resource now describes the written file
+  const bool reopen = this->resource_file != nullptr || this->resource_mapping != nullptr;
+  this->resource_path = path;
+  for (auto* asset : ordered_assets)
+    asset->source = this;
+  if (reopen)
+    this->open();
+}
+
+void libpak::resource::write_incremental()
+{
+  if (this->resource_file == nullptr && this->resource_mapping == nullptr)
+    throw std::runtime_error("resource must be read before an incremental write");
+
+  // the header table as it is on disk, every extent it references stays intact
+  std::vector<asset_header> disk_headers(this->content_header.assets_count);
+  this->read_asset_headers(0, disk_headers);
+
+  // collect the patched and the added assets
+  std::vector<asset*> dirty_assets;
+  uint32_t next_header_index = this->content_header.assets_count;
   for (auto& asset : this->assets | std::views::values)
   {
-    const auto header_origin = this->resource_stream->set_writer_cursor(
-      data_offset);
-    this->write_asset_data(asset);
+    if (asset.header_index == asset::UNINDEXED)
+      asset.header_index = next_header_index++;
+    else if (not asset.isPatched())
+      continue;
+    dirty_assets.push_back(&asset);
+  }
+  std::ranges::sort(dirty_assets, {}, [](const asset* asset) { return asset->header_index; });
 
-    // Return to the asset header origin
-    this->resource_stream->set_writer_cursor(header_origin);
+  const uint32_t assets_count = next_header_index;
+  const uint64_t header_table_end = PAK_ASSET_HEADERS_SECTOR
+    + static_cast<uint64_t>(assets_count) * sizeof(asset_header);
+  const uint64_t data_sector = std::max<uint64_t>(
+    PAK_DATA_SECTOR, header_table_end + sizeof(struct data_header));
+
+  // extents referenced from the disk, ordered by their offset
+  std::vector<std::pair<uint64_t, uint64_t>> extents;
+  for (const auto& header : disk_headers)
+  {
+    if (header.is_asset_embedded && header.embedded_data_length != 0)
+      extents.emplace_back(header.embedded_data_offset, header.embedded_data_length);
+  }
+  std::ranges::sort(extents);
 
-    this->write_asset_header(asset);
+  if (!extents.empty() && extents.front().first < data_sector)
+    throw std::runtime_error("header table is full, a full write is required");
 
-    // Offset the data cursor by the length of the embedded data.
-    data_offset += asset.header.embedded_data_length;
+  // holes between the extents, by their offset
+  std::vector<std::pair<uint64_t, uint64_t>> holes;
+  uint64_t data_end = data_sector;
+  for (const auto& [offset, length] : extents)
+  {
+    if (offset > data_end)
+      holes.emplace_back(data_end, offset - data_end);
+    data_end = std::max(data_end, offset + length);
   }
 
-  if (!this->resource_stream->write(this->data_header))
-    throw std::runtime_error("failed to write data header");
+  const file output(this->resource_path, file_mode::read_write);
+
+  // place the payloads into the smallest hole they fit in, or append them
+  const auto place = [&](const uint64_t length) -> uint64_t {
+    auto best = holes.end();
+    for (auto hole = holes.begin(); hole != holes.end(); ++hole)
+    {
+      if (hole->second >= length && (best == holes.end() || hole->second < best->second))
+        best = hole;
+    }
+
+    if (best == holes.end())
+    {
+      const uint64_t offset = data_end;
+      data_end += length;
+      return offset;
+    }
+
+    const uint64_t offset = best->first;
+    best->first += length;
+    best->second -= length;
+    if (best->second == 0)
+      holes.erase(best);
+    return offset;
+  };
+
+  this->compression_report = {};
+  const auto& codec = get_codec(this->compression_backend);
+  const unsigned workers_count = resolve_worker_count(this->worker_count);
+  ordered_pipeline<encoded_asset>(
+    dirty_assets.size(),
+    workers_count,
+    workers_count * 4,
+    [&](const size_t index) {
+      return this->encode_asset_data(
+        *dirty_assets[index], codec, this->compression_policy.get(), &this->scratch);
+    },
+    [&](const size_t index, encoded_asset&& encoded) {
+      auto& asset = *dirty_assets[index];
+      if (not encoded.has_data)
+        return;
+      report_compression(this->compression_report, asset, encoded);
+
+      const uint64_t offset = place(encoded.embedded_data.size());
+      if (offset + encoded.embedded_data.size() > UINT32_MAX)
+        throw std::runtime_error("resource is too large");
+      if (!output.write_at(encoded.embedded_data.data(), encoded.embedded_data.size(), offset))
+        throw std::runtime_error("failed to write asset data");
+      encoded.apply(asset.header, static_cast<uint32_t>(offset));
+    });
+
+  // the data must be on the disk before any header references it
+  if (!output.sync())
+    throw std::runtime_error("failed to flush asset data");
+
+  for (const auto* asset : dirty_assets)
+  {
+    const uint64_t header_offset = PAK_ASSET_HEADERS_SECTOR
+      + static_cast<uint64_t>(asset->header_index) * sizeof(asset_header);
+    if (!output.write_at(asset->header, header_offset))
+      throw std::runtime_error("failed to write asset header");
+  }
+
+  // the header table grew, move the data header after it
+  if (assets_count != this->content_header.assets_count)
+  {
+    if (!output.write_at(this->data_header, header_table_end))
+      throw std::runtime_error("failed to write data header");
+  }
+
+  this->content_header.assets_count = assets_count;
+  if (!output.write_at(this->content_header, PAK_CONTENT_SECTOR))
+    throw std::runtime_error("failed to write content header");
 
   // Update the intro PAKS header assets counts
-  this->pak_header.assets_count = this->assets.size();
-  this->pak_header.used_assets_count = this->assets.size();
+  this->pak_header.assets_count = assets_count;
+  this->pak_header.used_assets_count = assets_count;
   this->pak_header.deleted_assets_count = 0;
+  this->pak_header.file_size = header_table_end + sizeof(struct data_header);
+  if (!output.write_at(this->pak_header, 0))
+    throw std::runtime_error("failed to write pak header");
 
-  this->pak_header.file_size = this->resource_stream->get_writer_cursor();
+  if (!output.sync())
+    throw std::runtime_error("failed to flush resource headers");
 
-  // Write the intro PAKS header
-  this->resource_stream->set_writer_cursor(0);
-  if (!this->resource_stream->write(this->pak_header))
-    throw std::runtime_error("failed to write pak header");
+  for (auto* asset : dirty_assets)
+  {
+    asset->clearPatched();
+    asset->source = this;
+  }
+
+  // reopen the resource to see the appended data, which also drops
+  // payloads cached under reused offsets
+  this->open();
+}
+
+void libpak::resource::read_compact()
+{
+  this->open();
+
+  this->index.clear();
+  this->index.reserve(this->content_header.assets_count);
+
+  // the headers are decoded into the compact index and dropped
+  std::vector<asset_header> header_chunk(
+    std::min<uint32_t>(this->content_header.assets_count, ASSET_HEADERS_CHUNK));
+
+  for (uint32_t chunkIndex{0}; chunkIndex < content_header.assets_count;
+       chunkIndex += ASSET_HEADERS_CHUNK)
+  {
+    const auto chunk = std::span(header_chunk).first(
+      std::min<uint32_t>(content_header.assets_count - chunkIndex, ASSET_HEADERS_CHUNK));
+    this->read_asset_headers(chunkIndex, chunk);
+
+    for (const auto& header : chunk)
+    {
+      // handle invalid asset
+      if (header.asset_magic == 0x0)
+        throw std::runtime_error("failed to read asset: invalid asset header read");
+      this->index.add(header);
+    }
+  }
+
+  this->index.build();
+}
+
+void libpak::resource::read_asset_headers(const uint32_t first, const std::span<asset_header> headers)
+{
+  const uint64_t offset = PAK_ASSET_HEADERS_SECTOR
+    + static_cast<uint64_t>(first) * sizeof(asset_header);
+  const uint64_t size = headers.size_bytes();
 
-  this->output_stream->close();
+  if (this->resource_mapping != nullptr)
+  {
+    const auto table = this->resource_mapping->view(offset, size);
+    std::memcpy(headers.data(), table.data(), size);
+    return;
+  }
+
+  // one sequential read for the whole range
+  if (!this->resource_file->read_at(reinterpret_cast<std::byte*>(headers.data()), size, offset))
+    throw std::runtime_error("failed to read asset headers");
 }
 
-void libpak::resource::read_asset_header(asset& asset)
+libpak::scratch_buffer libpak::resource::read_embedded_data(const asset& asset) const
 {
-  auto& header = asset.header;
-  // read asset header
-  if (!this->resource_stream->read(header, header.asset_offset))
-    throw std::runtime_error("failed to read asset header");
+  const auto& header = asset.header;
+  const uint64_t embedded_size = header.embedded_data_length;
+  const uint64_t embedded_data_offset = header.embedded_data_offset;
+
+  // embedded data buffer
+  auto embedded_data = this->scratch.acquire(embedded_size);
+
+  // read the embedded data
+  if (this->resource_mapping != nullptr)
+  {
+    const auto embedded_view = this->view_asset_data(asset);
+    std::ranges::copy(embedded_view, embedded_data.data());
+  }
+  else if (this->resource_file == nullptr
+    || !this->resource_file->read_at(embedded_data.data(), embedded_size, embedded_data_offset))
+    throw std::runtime_error("couldn't read embedded data");
 
-  // handle invalid asset
-  if (header.asset_magic == 0x0)
-    throw std::runtime_error("invalid asset header read");
+  return embedded_data;
 }
 
-void libpak::resource::read_asset_data(asset& asset)
+void libpak::resource::read_asset_data(asset& asset) const
 {
-  auto& header = asset.header;
-  auto& data = asset.data;
+  const auto& header = asset.header;
   if (!header.is_asset_embedded)
     return;
 
-  uLongf embedded_size = asset.header.embedded_data_length;
-  const int64_t embedded_data_offset = header.embedded_data_offset;
+  // if data is not compressed or decompression is not requested,
+  // borrow the unprocessed data instead of copying it
+  if (not header.is_data_compressed || not this->decompress)
+  {
+    if (this->resource_mapping != nullptr)
+    {
+      asset.data.load(this->view_asset_data(asset), this->resource_mapping);
+      return;
+    }
 
-  // allocate embedded data buffer
-  std::vector<std::byte> embedded_data;
-  try
+    // read into an uninitialized buffer, sparing the zero-fill of a vector
+    const uint64_t embedded_size = header.embedded_data_length;
+    std::shared_ptr<std::byte[]> embedded_data;
+    try
+    {
+      embedded_data = std::make_shared_for_overwrite<std::byte[]>(embedded_size);
+    }
+    catch (std::bad_alloc& alloc)
+    {
+      throw std::runtime_error("not enough memory for embedded buffer");
+    }
+
+    if (this->resource_file == nullptr
+      || !this->resource_file->read_at(embedded_data.get(), embedded_size, header.embedded_data_offset))
+      throw std::runtime_error("couldn't read embedded data");
+
+    const std::span<const std::byte> embedded_view{embedded_data.get(), embedded_size};
+    asset.data.load(embedded_view, std::move(embedded_data));
+    return;
+  }
+
+  const auto& codec = get_codec(this->compression_backend);
+
+  // inflate straight from the mapping
+  if (this->resource_mapping != nullptr)
   {
-    embedded_data.resize(embedded_size);
+    inflate_data(header, this->view_asset_data(asset), codec, asset.data);
+    return;
   }
-  catch (std::bad_alloc& alloc)
+
+  const auto embedded_data = this->read_embedded_data(asset);
+  inflate_data(header, embedded_data.span(), codec, asset.data);
+}
+
+void libpak::resource::read_all_asset_data()
+{
+  using clock = std::chrono::steady_clock;
+  const auto read_begin = clock::now();
+  this->read_statistics = {};
+
+  // read the data in the order it is laid out in the resource
+  std::vector<asset*> ordered_assets;
+  ordered_assets.reserve(this->assets.size());
+  for (auto& asset : this->assets | std::views::values)
   {
-    throw std::runtime_error("not enough memory for embedded buffer");
+    if (asset.header.is_asset_embedded)
+      ordered_assets.push_back(&asset);
   }
+  std::ranges::sort(ordered_assets, {}, [](const asset* asset) {
+    return asset->header.embedded_data_offset;
+  });
 
-  // read the embedded data
-  if (!this->resource_stream->read(embedded_data.data(), embedded_size, embedded_data_offset))
-    throw std::runtime_error("couldn't read embedded data");
+  auto& io_stats = this->read_statistics.io;
 
-  // if data is not compressed, return the unprocessed buffer
-  // always return unprecessed buffer.
-  if (not header.is_data_compressed || true)
+  if (not this->decompress)
   {
-    asset.data.buffer = std::move(embedded_data);
+    for (auto* const asset : ordered_assets)
+    {
+      const auto busy_begin = clock::now();
+      try
+      {
+        this->read_asset_data(*asset);
+      }
+      catch (const std::runtime_error& err)
+      {
+        throw std::runtime_error(std::format("failed read asset data: {}", err.what()));
+      }
+      io_stats.assets++;
+      io_stats.bytes_in += asset->header.embedded_data_length;
+      io_stats.bytes_out += asset->data.size();
+      io_stats.busy_time += clock::now() - busy_begin;
+    }
+    this->read_statistics.wall_time = clock::now() - read_begin;
     return;
   }
 
-  // NPAK can compress small buffers and inflate them. Because to this,
-  // choose the largest data size for the decompressed data buffer.
-  uLongf decompressed_data_size = std::max(
-    header.embedded_data_length,
-    header.data_decompressed_length);
+  struct inflate_job
+  {
+    asset* target;
+    //! Embedded data, either viewed in the mapping or read into the buffer.
+    std::span<const std::byte> embedded_data;
+    scratch_buffer buffer;
+  };
+
+  const auto& codec = get_codec(this->compression_backend);
+  const unsigned workers_count = resolve_worker_count(this->worker_count);
+  bounded_queue<inflate_job> jobs(workers_count * 2);
+  this->read_statistics.workers.resize(workers_count);
+
+  // the first error stops the whole pipeline
+  std::mutex error_mutex;
+  std::string error;
+  std::atomic<bool> failed = false;
+  const auto fail = [&](const char* what) {
+    std::scoped_lock lock(error_mutex);
+    if (error.empty())
+      error = what;
+    failed = true;
+    jobs.close();
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(workers_count);
+  for (unsigned workerIndex{0}; workerIndex < workers_count; workerIndex++)
+  {
+    workers.emplace_back([&, workerIndex] {
+      auto& worker_stats = this->read_statistics.workers[workerIndex];
+      while (auto job = jobs.pop())
+      {
+        const auto busy_begin = clock::now();
+        try
+        {
+          inflate_data(job->target->header, job->embedded_data, codec, job->target->data);
+        }
+        catch (const std::exception& err)
+        {
+          fail(err.what());
+          return;
+        }
+        worker_stats.assets++;
+        worker_stats.bytes_in += job->embedded_data.size();
+        worker_stats.bytes_out += job->target->data.size();
+        worker_stats.busy_time += clock::now() - busy_begin;
+      }
+    });
+  }
 
-  // allocate buffer for data
+  // the calling thread reads the embedded data while the workers inflate
+  for (auto* const asset : ordered_assets)
+  {
+    if (failed)
+      break;
+
+    const auto busy_begin = clock::now();
+    inflate_job job;
+    job.target = asset;
+    try
+    {
+      // data stored as is is read, or borrowed, without the workers
+      if (not asset->header.is_data_compressed)
+      {
+        this->read_asset_data(*asset);
+      }
+      else if (this->resource_mapping != nullptr)
+      {
+        job.embedded_data = this->view_asset_data(*asset);
+      }
+      else
+      {
+        job.buffer = this->read_embedded_data(*asset);
+        job.embedded_data = job.buffer.span();
+      }
+    }
+    catch (const std::exception& err)
+    {
+      fail(err.what());
+      break;
+    }
+    io_stats.assets++;
+    io_stats.bytes_in += asset->header.embedded_data_length;
+    io_stats.busy_time += clock::now() - busy_begin;
+
+    if (not asset->header.is_data_compressed)
+    {
+      io_stats.bytes_out += asset->data.size();
+      continue;
+    }
+
+    if (!jobs.push(std::move(job)))
+      break;
+  }
+
+  jobs.close();
+  for (auto& worker : workers)
+    worker.join();
+
+  this->read_statistics.wall_time = clock::now() - read_begin;
+
+  if (failed)
+    throw std::runtime_error(std::format("failed read asset data: {}", error));
+}
+
+void libpak::resource::read_assets(
+  const std::span<asset* const> batch,
+  const std::function<void(asset&)>& completion)
+{
+  using clock = std::chrono::steady_clock;
+  const auto read_begin = clock::now();
+  this->read_statistics = {};
+  auto& io_stats = this->read_statistics.io;
+
+  // read the data in the order it is laid out in the resource
+  std::vector<asset*> ordered_assets;
+  ordered_assets.reserve(batch.size());
+  for (auto* const asset : batch)
+  {
+    if (asset->header.is_asset_embedded)
+      ordered_assets.push_back(asset);
+    else
+      completion(*asset);
+  }
+  std::ranges::sort(ordered_assets, {}, [](const asset* asset) {
+    return asset->header.embedded_data_offset;
+  });
+
+  const auto extents = merge_extents(ordered_assets);
+  const auto& codec = get_codec(this->compression_backend);
+  const uint32_t depth = std::max<uint32_t>(this->queue_depth, 1);
+
+  // delivers the assets of the extent, which borrow their data from it
+  const auto deliver = [&](
+    const read_extent& extent,
+    const std::span<const std::byte> extent_data,
+    const std::shared_ptr<const void>& owner) {
+    for (size_t index = extent.first_asset; index < extent.last_asset; ++index)
+    {
+      auto& asset = *ordered_assets[index];
+      const auto& header = asset.header;
+      const auto embedded_data = extent_data.subspan(
+        header.embedded_data_offset - extent.offset, header.embedded_data_length);
+
+      if (header.is_data_compressed && this->decompress)
+        inflate_data(header, embedded_data, codec, asset.data);
+      else
+        asset.data.load(embedded_data, owner);
+
+      io_stats.assets++;
+      io_stats.bytes_in += header.embedded_data_length;
+      io_stats.bytes_out += asset.data.size();
+      completion(asset);
+    }
+  };
+
+  const auto finish = [&] {
+    this->read_statistics.wall_time = clock::now() - read_begin;
+    io_stats.busy_time = this->read_statistics.wall_time;
+  };
+
+  if (this->resource_mapping != nullptr)
+  {
+    // the kernel reads the extents ahead, while the data of the previous ones is delivered
+    for (size_t index = 0; index < extents.size(); ++index)
+    {
+      if (index == 0)
+      {
+        for (size_t ahead = 0; ahead < std::min<size_t>(depth, extents.size()); ++ahead)
+          this->resource_mapping->prefetch(extents[ahead].offset, extents[ahead].size);
+      }
+      else if (index + depth - 1 < extents.size())
+      {
+        const auto& ahead = extents[index + depth - 1];
+        this->resource_mapping->prefetch(ahead.offset, ahead.size);
+      }
+
+      const auto& extent = extents[index];
+      deliver(extent, this->resource_mapping->view(extent.offset, extent.size), this->resource_mapping);
+    }
+    finish();
+    return;
+  }
+
+  if (this->resource_file == nullptr)
+    throw std::runtime_error("resource is not open");
+  const auto& input = *this->resource_file;
+
+  // the buffers are declared before the ring and outlive it,
+  // so no read in flight targets a freed buffer
+  std::vector<std::shared_ptr<std::byte[]>> buffers;
+  std::optional<io_ring> ring;
   try
   {
-    data.buffer.resize(decompressed_data_size);
+    ring.emplace(depth);
   }
-  catch (std::bad_alloc& alloc)
+  catch (const std::runtime_error&)
   {
-    throw std::runtime_error("not enough memory for data buffer");
+    // the thread pool takes over
   }
 
-  // uncompress
-  const auto compression_result = uncompress2(
-    reinterpret_cast<Bytef*>(data.buffer.data()),
-    &decompressed_data_size,
-    reinterpret_cast<Bytef*>(embedded_data.data()),
-    &embedded_size);
-
-  switch (compression_result)
-  {
-    case Z_BUF_ERROR:
-    case Z_MEM_ERROR:
-      throw std::runtime_error("not enough memory for uncompressed data");
-    case Z_DATA_ERROR:
-      throw std::runtime_error("corrupted compressed data");
-    default:
-      {};
-      break;
+  if (ring)
+  {
+    buffers.resize(extents.size());
+    std::vector<uint64_t> received(extents.size());
+    std::exception_ptr error;
+    size_t next_extent = 0;
+    uint32_t in_flight = 0;
+
+    const auto fail = [&](const char* what) {
+      if (!error)
+        error = std::make_exception_ptr(std::runtime_error(what));
+    };
+
+    // reads the rest of the extent
+    const auto prepare = [&](const size_t index) {
+      const auto& extent = extents[index];
+      return ring->prepare_read(
+        input,
+        buffers[index].get() + received[index],
+        static_cast<uint32_t>(extent.size - received[index]),
+        extent.offset + received[index],
+        index);
+    };
+
+    while (next_extent < extents.size() || in_flight > 0)
+    {
+      // keep the queue full
+      while (!error && next_extent < extents.size() && in_flight < depth)
+      {
+        try
+        {
+          buffers[next_extent] = allocate_extent(extents[next_extent].size);
+        }
+        catch (const std::runtime_error&)
+        {
+          error = std::current_exception();
+          break;
+        }
+        if (!prepare(next_extent))
+          break;
+        next_extent++;
+        in_flight++;
+      }
+
+      if (!error && !ring->submit())
+      {
+        // the reads never submitted will not complete
+        in_flight -= ring->pending();
+        fail("failed to submit extent reads");
+      }
+
+      if (error)
+      {
+        // drain the reads in flight before giving up
+        next_extent = extents.size();
+        if (in_flight == 0)
+          break;
+      }
+
+      const auto completed = ring->wait();
+      in_flight--;
+      if (error)
+        continue;
+
+      const auto index = static_cast<size_t>(completed.user_data);
+      if (completed.result == -EINTR || completed.result == -EAGAIN)
+      {
+        prepare(index);
+        in_flight++;
+        continue;
+      }
+      if (completed.result <= 0)
+      {
+        fail("couldn't read embedded data");
+        continue;
+      }
+
+      // short reads are resumed
+      received[index] += static_cast<uint64_t>(completed.result);
+      if (received[index] < extents[index].size)
+      {
+        prepare(index);
+        in_flight++;
+        continue;
+      }
+
+      auto buffer = std::move(buffers[index]);
+      try
+      {
+        deliver(extents[index], {buffer.get(), extents[index].size}, buffer);
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+    }
+
+    finish();
+    if (error)
+      std::rethrow_exception(error);
+    return;
+  }
+
+  struct read_result
+  {
+    size_t index;
+    std::shared_ptr<std::byte[]> buffer;
+    std::string error;
+  };
+
+  // worker threads keep the reads in flight
+  const auto workers_count = static_cast<unsigned>(std::min<size_t>(depth, extents.size()));
+  bounded_queue<read_result> results(depth);
+  std::atomic<size_t> next_extent = 0;
+
+  std::vector<std::thread> workers;
+  workers.reserve(workers_count);
+  for (unsigned workerIndex{0}; workerIndex < workers_count; workerIndex++)
+  {
+    workers.emplace_back([&] {
+      for (size_t index = next_extent++; index < extents.size(); index = next_extent++)
+      {
+        read_result result;
+        result.index = index;
+        try
+        {
+          const auto& extent = extents[index];
+          result.buffer = allocate_extent(extent.size);
+          if (!input.read_at(result.buffer.get(), extent.size, extent.offset))
+            throw std::runtime_error("couldn't read embedded data");
+        }
+        catch (const std::exception& err)
+        {
+          result.error = err.what();
+        }
+        if (!results.push(std::move(result)))
+          return;
+      }
+    });
   }
+
+  // the calling thread delivers the extents as they arrive
+  std::exception_ptr error;
+  try
+  {
+    for (size_t delivered = 0; delivered < extents.size(); ++delivered)
+    {
+      const auto result = results.pop();
+      if (!result->error.empty())
+        throw std::runtime_error(result->error);
+      deliver(extents[result->index], {result->buffer.get(), extents[result->index].size}, result->buffer);
+    }
+  }
+  catch (...)
+  {
+    error = std::current_exception();
+  }
+
+  results.close();
+  for (auto& worker : workers)
+    worker.join();
+
+  finish();
+  if (error)
+    std::rethrow_exception(error);
 }
 
-void libpak::resource::write_asset_header(const asset& asset)
+const libpak::asset* libpak::resource::find(const std::string_view path) const
 {
-  const auto& header = asset.header;
-  // write the asset header
-  if (!this->resource_stream->write(header))
-    throw std::runtime_error("failed to write asset header");
+  const auto entry = this->paths.find(path, [this](const uint32_t entry) {
+    return this->indexed_assets[entry]->path_view();
+  });
+  return entry ? this->indexed_assets[*entry] : nullptr;
 }
 
-void libpak::resource::write_asset_data(libpak::asset& asset)
+libpak::asset* libpak::resource::find(const std::string_view path)
 {
-  if (not asset.header.is_asset_embedded || asset.data.buffer.empty())
-    return;
+  return const_cast<asset*>(std::as_const(*this).find(path));
+}
 
-  // calculate the CRC and checksum of the decompressed data.
-  const uLongf decompressed_crc = crc32(
-    0, // initial crc cycle value
-    reinterpret_cast<const Bytef*>(asset.data.buffer.data()),
-    asset.header.data_decompressed_length);
+const libpak::asset* libpak::resource::find(const std::u16string_view path) const
+{
+  const auto entry = this->paths.find(path, [this](const uint32_t entry) {
+    return this->indexed_assets[entry]->path_view();
+  });
+  return entry ? this->indexed_assets[*entry] : nullptr;
+}
 
-  const uint32_t decompressed_checksum = alicia_checksum(
-    reinterpret_cast<const char*>(asset.data.buffer.data()),
-    asset.header.data_decompressed_length);
+libpak::asset* libpak::resource::find(const std::u16string_view path)
+{
+  return const_cast<asset*>(std::as_const(*this).find(path));
+}
 
-  uLongf embedded_crc{};
-  uLongf embedded_checksum{};
+void libpak::resource::reindex()
+{
+  this->indexed_assets.clear();
+  this->indexed_assets.reserve(this->assets.size());
+  for (auto& asset : this->assets | std::views::values)
+    this->indexed_assets.push_back(&asset);
 
-  asset.header.embedded_data_offset = resource_stream->get_writer_cursor();
+  this->paths.build(this->indexed_assets.size(), [this](const uint32_t entry) {
+    return this->indexed_assets[entry]->path_view();
+  });
+}
 
-  if (asset.header.is_data_compressed)
-  {
-    uLongf compressed_size = std::max(
-      asset.header.data_decompressed_length,
-      asset.header.embedded_data_length);
+libpak::shared_payload libpak::resource::load_payload(const asset& asset)
+{
+  if (!asset.header.is_asset_embedded)
+    return std::make_shared<const asset_data>();
 
-    std::vector<std::byte> compressed_data_buffer;
-    compressed_data_buffer.resize(compressed_size);
+  // embedded data offset uniquely identifies the payload within the resource
+  const uint64_t key = asset.header.embedded_data_offset;
+  if (auto payload = this->cache.find(key))
+    return payload;
 
-    compress2(
-      reinterpret_cast<Bytef*>(compressed_data_buffer.data()),
-      &compressed_size,
-      reinterpret_cast<Bytef*>(asset.data.buffer.data()),
-      asset.header.data_decompressed_length,
-      9 /* compression level*/);
+  libpak::asset loaded;
+  loaded.header = asset.header;
+  this->read_asset_data(loaded);
 
-    // calculate the crc and checksum of the now compressed data
+  auto payload = std::make_shared<const asset_data>(std::move(loaded.data));
+  this->cache.insert(key, payload);
+  return payload;
+}
 
-    embedded_crc = crc32(
-      0, // initial crc cycle value
-      reinterpret_cast<Bytef*>(compressed_data_buffer.data()),
-      compressed_size);
+libpak::shared_payload libpak::asset::payload() const
+{
+  if (this->source == nullptr)
+    throw std::runtime_error("asset is not backed by a resource");
+  return this->source->load_payload(*this);
+}
 
-    embedded_checksum = alicia_checksum(
-      reinterpret_cast<const char*>(compressed_data_buffer.data()),
-      compressed_size);
+std::span<const std::byte> libpak::resource::view_asset_data(const asset& asset) const
+{
+  if (this->resource_mapping == nullptr)
+    throw std::runtime_error("resource is not mapped");
 
-    // write the compressed data
-    resource_stream->write(
-      reinterpret_cast<const uint8_t*>(compressed_data_buffer.data()),
-      compressed_size);
+  return this->resource_mapping->view(
+    asset.header.embedded_data_offset,
+    asset.header.embedded_data_length);
+}
 
-    asset.header.embedded_data_length = compressed_size;
-  }
-  else
+libpak::encoded_asset libpak::resource::encode_asset_data(
+  const asset& asset,
+  const codec& codec,
+  const libpak::compression_policy* policy,
+  scratch_pool* scratch)
+{
+  encoded_asset encoded;
+  if (not asset.header.is_asset_embedded || asset.data.empty())
+    return encoded;
+
+  const auto data = asset.data.bytes().first(
+    std::min<size_t>(asset.data.size(), asset.header.data_decompressed_length));
+
+  encoded.has_data = true;
+
+  // calculate the CRC and checksum of the decompressed data in one pass.
+  const auto decompressed_digest = alg::crc32_checksum(
+    reinterpret_cast<const char*>(data.data()),
+    data.size());
+  encoded.crc_decompressed = decompressed_digest.crc;
+  encoded.checksum_decompressed = decompressed_digest.checksum;
+
+  if (asset.header.is_data_compressed)
   {
-    // Both embedded CRC and checksums are identical.
-    embedded_crc = decompressed_crc;
-    embedded_checksum = decompressed_checksum;
+    const auto compression_begin = std::chrono::steady_clock::now();
 
-    // write the decompresssed data
-    resource_stream->write(
-      reinterpret_cast<const uint8_t*>(asset.data.buffer.data()),
-      asset.header.data_decompressed_length);
+    // the policy may store data that does not compress well raw
+    int level = 9;
+    if (policy != nullptr)
+    {
+      level = policy->level(asset.path_view(), data.size());
+      if (level != 0 && !policy->is_compressible(data, codec))
+        level = 0;
+    }
 
-    asset.header.embedded_data_length = asset.header.data_decompressed_length;
+    if (level != 0)
+    {
+      // incompressible data grows, size the buffer for the worst case
+      const uint64_t compressed_bound = codec.compress_bound(data.size());
+      encoded.compressed_data = scratch != nullptr
+        ? scratch->acquire(compressed_bound)
+        : scratch_buffer(compressed_bound);
+      const uint64_t compressed_size = codec.compress(
+        data,
+        encoded.compressed_data.span(),
+        level);
+      encoded.compressed_data.truncate(compressed_size);
+
+      encoded.compressed = policy == nullptr
+        || policy->is_worth_storing(data.size(), compressed_size);
+      if (not encoded.compressed)
+        encoded.compressed_data.reset();
+    }
+
+    encoded.compression_time = std::chrono::steady_clock::now() - compression_begin;
   }
 
-  // update the header crcs and checksums
+  if (encoded.compressed)
+  {
+    encoded.embedded_data = encoded.compressed_data.span();
+
+    // calculate the crc and checksum of the now compressed data
+    const auto embedded_digest = alg::crc32_checksum(
+      reinterpret_cast<const char*>(encoded.compressed_data.data()),
+      encoded.compressed_data.size());
+    encoded.crc_embedded = embedded_digest.crc;
+    encoded.checksum_embedded = embedded_digest.checksum;
+  }
+  else
+  {
+    // Both embedded CRC and checksums are identical.
+    encoded.embedded_data = data;
+    encoded.crc_embedded = encoded.crc_decompressed;
+    encoded.checksum_embedded = encoded.checksum_decompressed;
+  }
 
-  asset.header.crc_decompressed = decompressed_crc;
-  asset.header.checksum_decompressed = decompressed_checksum;
-  asset.header.crc_embedded = embedded_crc;
-  asset.header.checksum_embedded = embedded_checksum;
+  return encoded;
 }
 
 void libpak::resource::destroy() noexcept
@@ -406,4 +1455,10 @@ void libpak::resource::destroy() noexcept
   this->content_header = {};
   this->data_header = {};
   this->assets.clear();
+  this->index.clear();
+  this->paths.clear();
+  this->indexed_assets.clear();
+  this->cache.clear();
+  this->resource_mapping.reset();
+  this->resource_file.reset();
 }
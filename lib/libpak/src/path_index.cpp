@@ -0,0 +1,225 @@
+#include "libpak/path_index.hpp"
+
+namespace
+{
+
+//! Replacement for the bytes of malformed UTF-8 sequences.
+constexpr char32_t REPLACEMENT = 0xFFFD;
+
+/**
+ * Decodes code points from UTF-16.
+ */
+class utf16_decoder
+{
+public:
+  explicit utf16_decoder(const std::u16string_view text) noexcept : text(text) {}
+
+  /**
+   * Decodes the next code point.
+   * @param code_point Decoded code point.
+   * @return False when there are no more code points.
+   */
+  bool next(char32_t& code_point) noexcept
+  {
+    if (this->position >= this->text.size())
+      return false;
+
+    const char16_t unit = this->text[this->position++];
+    code_point = unit;
+
+    // combine the surrogate pair, lone surrogates are kept as they are
+    if (unit >= 0xD800 && unit < 0xDC00 && this->position < this->text.size())
+    {
+      const char16_t low = this->text[this->position];
+      if (low >= 0xDC00 && low < 0xE000)
+      {
+        code_point = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+        this->position++;
+      }
+    }
+    return true;
+  }
+
+private:
+  std::u16string_view text;
+  size_t position = 0;
+};
+
+/**
+ * Decodes code points from UTF-8.
+ */
+class utf8_decoder
+{
+public:
+  explicit utf8_decoder(const std::string_view text) noexcept : text(text) {}
+
+  /**
+   * Decodes the next code point.
+   * @param code_point Decoded code point.
+   * @return False when there are no more code points.
+   */
+  bool next(char32_t& code_point) noexcept
+  {
+    if (this->position >= this->text.size())
+      return false;
+
+    const auto lead = static_cast<unsigned char>(this->text[this->position++]);
+    if (lead < 0x80)
+    {
+      code_point = lead;
+      return true;
+    }
+
+    unsigned continuation_count;
+    if ((lead & 0xE0) == 0xC0)
+    {
+      continuation_count = 1;
+      code_point = lead & 0x1F;
+    }
+    else if ((lead & 0xF0) == 0xE0)
+    {
+      continuation_count = 2;
+      code_point = lead & 0x0F;
+    }
+    else if ((lead & 0xF8) == 0xF0)
+    {
+      continuation_count = 3;
+      code_point = lead & 0x07;
+    }
+    else
+    {
+      code_point = REPLACEMENT;
+      return true;
+    }
+
+    for (; continuation_count != 0; --continuation_count)
+    {
+      if (this->position >= this->text.size()
+        || (static_cast<unsigned char>(this->text[this->position]) & 0xC0) != 0x80)
+      {
+        code_point = REPLACEMENT;
+        return true;
+      }
+      code_point = (code_point << 6) | (static_cast<unsigned char>(this->text[this->position++]) & 0x3F);
+    }
+    return true;
+  }
+
+private:
+  std::string_view text;
+  size_t position = 0;
+};
+
+/**
+ * Hashes code points with 64-bit FNV-1a followed by a final mix.
+ * @tparam Decoder Decoder type.
+ * @param decoder  Decoder.
+ * @return Hash.
+ */
+template <typename Decoder>
+uint64_t hash_code_points(Decoder decoder) noexcept
+{
+  uint64_t hash = 0xCBF29CE484222325;
+  char32_t code_point;
+  while (decoder.next(code_point))
+  {
+    hash ^= code_point;
+    hash *= 0x100000001B3;
+  }
+
+  // FNV leaves the low bits poorly mixed, which open addressing relies on
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCD;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+} // namespace
+
+uint64_t libpak::path_index::hash(const std::u16string_view path) noexcept
+{
+  return hash_code_points(utf16_decoder(path));
+}
+
+uint64_t libpak::path_index::hash(const std::string_view path) noexcept
+{
+  return hash_code_points(utf8_decoder(path));
+}
+
+bool libpak::path_index::equals(const std::u16string_view lhs, const std::string_view rhs) noexcept
+{
+  utf16_decoder lhs_decoder(lhs);
+  utf8_decoder rhs_decoder(rhs);
+
+  char32_t lhs_code_point;
+  char32_t rhs_code_point;
+  while (true)
+  {
+    const bool lhs_next = lhs_decoder.next(lhs_code_point);
+    const bool rhs_next = rhs_decoder.next(rhs_code_point);
+    if (lhs_next != rhs_next)
+      return false;
+    if (!lhs_next)
+      return true;
+    if (lhs_code_point != rhs_code_point)
+      return false;
+  }
+}
+
+std::string libpak::path_index::to_utf8(const std::u16string_view path)
+{
+  std::string result;
+  result.reserve(path.size());
+
+  utf16_decoder decoder(path);
+  char32_t code_point;
+  while (decoder.next(code_point))
+  {
+    if (code_point < 0x80)
+    {
+      result.push_back(static_cast<char>(code_point));
+    }
+    else if (code_point < 0x800)
+    {
+      result.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+      result.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+    else if (code_point < 0x10000)
+    {
+      result.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+      result.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+      result.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+    else
+    {
+      result.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+      result.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+      result.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+      result.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+  }
+  return result;
+}
+
+std::u16string libpak::path_index::to_utf16(const std::string_view path)
+{
+  std::u16string result;
+  result.reserve(path.size());
+
+  utf8_decoder decoder(path);
+  char32_t code_point;
+  while (decoder.next(code_point))
+  {
+    if (code_point < 0x10000)
+    {
+      result.push_back(static_cast<char16_t>(code_point));
+    }
+    else
+    {
+      code_point -= 0x10000;
+      result.push_back(static_cast<char16_t>(0xD800 | (code_point >> 10)));
+      result.push_back(static_cast<char16_t>(0xDC00 | (code_point & 0x3FF)));
+    }
+  }
+  return result;
+}
@@ -0,0 +1,170 @@
+#include "libpak/scratch.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+
+//! Smallest block, smaller buffers share blocks of this size.
+constexpr uint64_t MIN_BLOCK_SIZE = 4096;
+
+/**
+ * Allocates an uninitialized block.
+ * @param capacity Capacity of the block.
+ * @throws std::runtime_error when the block can't be allocated.
+ * @return Block.
+ */
+std::unique_ptr<std::byte[]> allocate_block(const uint64_t capacity)
+{
+  try
+  {
+    return std::make_unique_for_overwrite<std::byte[]>(capacity);
+  }
+  catch (const std::bad_alloc&)
+  {
+    throw std::runtime_error("not enough memory for scratch buffer");
+  }
+}
+
+} // namespace
+
+libpak::scratch_buffer::scratch_buffer(const uint64_t size)
+  : block(allocate_block(size))
+  , capacity(size)
+  , buffer_size(size)
+{
+}
+
+libpak::scratch_buffer::scratch_buffer(
+  scratch_pool* pool,
+  std::unique_ptr<std::byte[]> block,
+  const uint64_t capacity,
+  const uint64_t size) noexcept
+  : pool(pool)
+  , block(std::move(block))
+  , capacity(capacity)
+  , buffer_size(size)
+{
+}
+
+libpak::scratch_buffer::scratch_buffer(scratch_buffer&& other) noexcept
+  : pool(std::exchange(other.pool, nullptr))
+  , block(std::move(other.block))
+  , capacity(std::exchange(other.capacity, 0))
+  , buffer_size(std::exchange(other.buffer_size, 0))
+{
+}
+
+libpak::scratch_buffer& libpak::scratch_buffer::operator=(scratch_buffer&& other) noexcept
+{
+  if (this != &other)
+  {
+    this->reset();
+    this->pool = std::exchange(other.pool, nullptr);
+    this->block = std::move(other.block);
+    this->capacity = std::exchange(other.capacity, 0);
+    this->buffer_size = std::exchange(other.buffer_size, 0);
+  }
+  return *this;
+}
+
+libpak::scratch_buffer::~scratch_buffer() noexcept
+{
+  this->reset();
+}
+
+void libpak::scratch_buffer::truncate(const uint64_t size) noexcept
+{
+  if (size < this->buffer_size)
+    this->buffer_size = size;
+}
+
+void libpak::scratch_buffer::reset() noexcept
+{
+  if (this->pool != nullptr && this->block != nullptr)
+    this->pool->release(std::move(this->block), this->capacity);
+
+  this->pool = nullptr;
+  this->block.reset();
+  this->capacity = 0;
+  this->buffer_size = 0;
+}
+
+libpak::scratch_buffer libpak::scratch_pool::acquire(const uint64_t size)
+{
+  const uint64_t capacity = std::bit_ceil(std::max(size, MIN_BLOCK_SIZE));
+  {
+    std::scoped_lock lock(this->mutex);
+
+    // the smallest pooled block the buffer fits in
+    auto best = this->blocks.end();
+    for (auto block = this->blocks.begin(); block != this->blocks.end(); ++block)
+    {
+      if (block->capacity >= capacity && (best == this->blocks.end() || block->capacity < best->capacity))
+        best = block;
+    }
+
+    if (best != this->blocks.end())
+    {
+      pooled_block pooled = std::move(*best);
+      *best = std::move(this->blocks.back());
+      this->blocks.pop_back();
+
+      this->statistics.reuses++;
+      this->statistics.bytes_retained -= pooled.capacity;
+      return {this, std::move(pooled.block), pooled.capacity, size};
+    }
+
+    this->statistics.allocations++;
+    this->statistics.bytes_allocated += capacity;
+  }
+
+  return {this, allocate_block(capacity), capacity, size};
+}
+
+void libpak::scratch_pool::set_retained_limit(const uint64_t limit) noexcept
+{
+  std::scoped_lock lock(this->mutex);
+  this->retained_limit = limit;
+  while (this->statistics.bytes_retained > this->retained_limit)
+  {
+    this->statistics.bytes_retained -= this->blocks.back().capacity;
+    this->blocks.pop_back();
+  }
+}
+
+void libpak::scratch_pool::clear() noexcept
+{
+  std::scoped_lock lock(this->mutex);
+  this->blocks.clear();
+  this->statistics.bytes_retained = 0;
+}
+
+libpak::scratch_stats libpak::scratch_pool::stats() const noexcept
+{
+  std::scoped_lock lock(this->mutex);
+  return this->statistics;
+}
+
+void libpak::scratch_pool::release(
+  std::unique_ptr<std::byte[]> block,
+  const uint64_t capacity) noexcept
+{
+  std::scoped_lock lock(this->mutex);
+  if (this->statistics.bytes_retained + capacity > this->retained_limit)
+    return;
+
+  try
+  {
+    this->blocks.push_back({std::move(block), capacity});
+    this->statistics.bytes_retained += capacity;
+  }
+  catch (const std::bad_alloc&)
+  {
+    // the block is freed instead
+  }
+}
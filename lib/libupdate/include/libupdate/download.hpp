@@ -0,0 +1,143 @@
+#ifndef LIBUPDATE_DOWNLOAD_HPP
+#define LIBUPDATE_DOWNLOAD_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace libupdate {
+    /**
+     * Server the updates are downloaded from.
+     */
+    struct server {
+        std::string host = "localhost";
+        std::string port = "443";
+        //! Whether the connections use TLS, plain HTTP is meant for loopback servers.
+        bool tls = true;
+    };
+
+    /**
+     * Options of the download engine.
+     */
+    struct download_options {
+        //! Count of the pooled keep-alive connections, which limits the concurrent downloads.
+        unsigned connections = 6;
+        //! Count of the retries of a failed download, each over a fresh connection.
+        unsigned retries = 2;
+        //! Timeout of each connect, handshake, request and response.
+        std::chrono::milliseconds timeout = std::chrono::seconds(30);
+        //! Largest accepted response body.
+        uint64_t body_limit = 512ull * 1024 * 1024;
+    };
+
+    /**
+     * Request of a download.
+     */
+    struct download_request {
+        std::string target;
+        //! Entity tag of the copy the client has, the server answers 304 while it matches.
+        std::string if_none_match = {};
+    };
+
+    /**
+     * Result of a download.
+     */
+    struct download_result {
+        std::string target;
+        //! HTTP status, zero if no response arrived.
+        unsigned status = 0;
+        //! Response header fields, by their name and value.
+        std::vector<std::pair<std::string, std::string>> headers;
+        std::string body;
+        //! Error of the download, empty if a response arrived.
+        std::string error;
+
+        [[nodiscard]]
+        bool ok() const noexcept { return error.empty() && status == 200; }
+
+        //! @return Whether the server answered that the client's copy is current.
+        [[nodiscard]]
+        bool not_modified() const noexcept { return error.empty() && status == 304; }
+
+        /**
+         * @param name Name of the header field, case-insensitive.
+         * @return Value of the header field, empty if the response has none.
+         */
+        [[nodiscard]]
+        std::string_view header(std::string_view name) const noexcept;
+    };
+
+    /**
+     * Statistics of the download engine.
+     */
+    struct download_stats {
+        //! Count of the established connections.
+        uint64_t connections = 0;
+        //! Count of the sent requests, including the retries.
+        uint64_t requests = 0;
+        //! Count of the retried requests.
+        uint64_t retries = 0;
+        //! Count of the received body bytes.
+        uint64_t bytes = 0;
+    };
+
+    /**
+     * Downloads many targets concurrently over a pool of keep-alive connections
+     * to one server. Connections stay open between fetches, so the handshake
+     * is paid once per connection instead of once per target. Not thread-safe.
+     */
+    class downloader {
+        struct engine;
+        std::unique_ptr<engine> _engine;
+
+    public:
+        explicit downloader(server origin, download_options options = {});
+        ~downloader();
+
+        downloader(downloader const&) = delete;
+        downloader& operator=(downloader const&) = delete;
+
+        /**
+         * Fetches the targets with at most `connections` requests in flight, blocking until all
+         * of them completed. Failed downloads are reported in their result instead of throwing.
+         * @param targets    Request targets, such as "/update/res.pak.manifest".
+         * @param completion Called on the calling thread for each target as it completes.
+         * @throws std::runtime_error when the server can't be resolved.
+         */
+        void fetch(std::span<std::string const> targets, std::function<void(download_result&&)> const& completion);
+
+        /**
+         * Fetches the requests, like the targets.
+         * @param requests   Requests.
+         * @param completion Called on the calling thread for each request as it completes.
+         * @throws std::runtime_error when the server can't be resolved.
+         */
+        void fetch(std::span<download_request const> requests,
+                   std::function<void(download_result&&)> const& completion);
+
+        /**
+         * Fetches a single target.
+         * @param target        Request target.
+         * @param if_none_match Entity tag of the copy the client has, if any.
+         * @throws std::runtime_error when the download fails.
+         * @return Successful result, or not modified one when the entity tag matches.
+         */
+        download_result get(std::string const& target, std::string const& if_none_match = {});
+
+        /**
+         * Closes the pooled connections.
+         */
+        void close() noexcept;
+
+        [[nodiscard]]
+        download_stats const& stats() const noexcept;
+    };
+} // namespace libupdate
+
+#endif // LIBUPDATE_DOWNLOAD_HPP
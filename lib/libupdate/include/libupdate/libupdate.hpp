@@ -1,10 +1,15 @@
 #ifndef LIBUPDATE_HPP
 #define LIBUPDATE_HPP
 
+#include "download.hpp"
+#include "manifest.hpp"
+
 #include <atomic>
-#include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace libupdate {
@@ -17,15 +22,37 @@ namespace libupdate {
         double percentage;
     };
 
+    /**
+     * Version of a manifest, as the server sent it.
+     */
+    struct manifest_version {
+        //! Version of the manifest, zero if the server does not version it.
+        uint32_t version = 0;
+        //! Entity tag of the manifest response, empty if the server sent none.
+        std::string etag;
+    };
+
     class update {
         std::mutex _mutex    = {};
         progress   _progress = {};
         std::atomic<bool> _paused = false;
-        std::map<std::string, uint32_t> _manifest = {};
+        manifest _manifest = {};
+        std::optional<binary_manifest> _binary_manifest = {};
+        std::optional<manifest> _delta = {};
+        manifest_version _applied = {};
+        manifest_version _fetched = {};
         std::vector<std::string> _marked = {};
-        void update_manifest();
+        std::unique_ptr<downloader> _downloader;
+        [[nodiscard]]
+        bool update_manifest();
+        void download_marked();
+        void patch_marked();
+        [[nodiscard]]
+        std::optional<uint32_t> manifest_crc(std::string_view path) const noexcept;
 
     public:
+        explicit update(server origin = {}, download_options options = {});
+
         [[nodiscard]]
         progress get_progress() const noexcept;
 
@@ -0,0 +1,214 @@
+#ifndef LIBUPDATE_MANIFEST_HPP
+#define LIBUPDATE_MANIFEST_HPP
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace libupdate {
+    /**
+     * @param path Path of the asset.
+     * @return 64-bit FNV-1a hash of the path.
+     */
+    [[nodiscard]]
+    constexpr uint64_t path_hash(std::string_view const path) noexcept {
+        uint64_t hash = 0xCBF29CE484222325;
+        for (char const c : path) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001B3;
+        }
+        return hash;
+    }
+
+    /**
+     * Manifest of the assets on the server, parsed from the text format of
+     * one `path:crc` line per asset, the CRC in hexadecimal. The entries
+     * reference the paths inside of the text and are sorted by the hash of
+     * the path, so lookups compare integers and touch the text only on a match.
+     */
+    class manifest {
+        struct entry {
+            uint64_t hash;
+            uint32_t path_offset;
+            uint32_t path_length;
+            uint32_t crc;
+        };
+
+        std::string _text;
+        std::vector<entry> _entries;
+
+        [[nodiscard]]
+        std::string_view path_of(entry const& entry) const noexcept {
+            return std::string_view(_text).substr(entry.path_offset, entry.path_length);
+        }
+
+    public:
+        manifest() = default;
+
+        /**
+         * Parses the manifest, taking the ownership of the text. Paths may be of any length,
+         * the first of duplicate paths wins.
+         * @param text Text of the manifest.
+         * @throws std::runtime_error when a line is malformed.
+         * @return Manifest.
+         */
+        static manifest parse(std::string text);
+
+        /**
+         * @param path Path of the asset.
+         * @return CRC of the asset, if the manifest lists it.
+         */
+        [[nodiscard]]
+        std::optional<uint32_t> find(std::string_view path) const noexcept;
+
+        [[nodiscard]]
+        bool contains(std::string_view const path) const noexcept { return find(path).has_value(); }
+
+        //! @return Count of the entries.
+        [[nodiscard]]
+        size_t size() const noexcept { return _entries.size(); }
+
+        //! @return Path of the entry, entries are sorted by the hash of it.
+        [[nodiscard]]
+        std::string_view path(size_t const index) const noexcept { return path_of(_entries[index]); }
+
+        //! @return CRC of the entry.
+        [[nodiscard]]
+        uint32_t crc(size_t const index) const noexcept { return _entries[index].crc; }
+
+        void clear() noexcept {
+            _text.clear();
+            _entries.clear();
+        }
+    };
+
+    //! Magic of the binary manifest, "AMFT".
+    constexpr uint32_t BINARY_MANIFEST_MAGIC = 0x54464D41;
+    //! Version of the binary manifest format.
+    constexpr uint32_t BINARY_MANIFEST_VERSION = 1;
+
+    /**
+     * Header of the binary manifest. It is followed by the entry table,
+     * sorted by the path hash, and then the string pool of the UTF-8 paths.
+     * All values are little-endian.
+     */
+    struct binary_manifest_header {
+        uint32_t magic = BINARY_MANIFEST_MAGIC;
+        uint32_t version = BINARY_MANIFEST_VERSION;
+        uint32_t entry_count = 0;
+        uint32_t reserved = 0;
+        //! Offset of the string pool from the start of the manifest.
+        uint64_t pool_offset = 0;
+        uint64_t pool_size = 0;
+    };
+
+    /**
+     * Entry of the binary manifest.
+     */
+    struct binary_manifest_entry {
+        //! Hash of the path, see binary_path_hash().
+        uint32_t path_hash;
+        //! Offset of the path in the string pool.
+        uint32_t path_offset;
+        //! CRC of the asset's embedded data.
+        uint32_t crc;
+        //! Size of the asset's embedded data.
+        uint32_t size;
+        //! Offset of the asset's embedded data in the resource.
+        uint32_t offset;
+        uint16_t path_length;
+        uint16_t reserved;
+    };
+
+    static_assert(sizeof(binary_manifest_header) == 32);
+    static_assert(sizeof(binary_manifest_entry) == 24);
+
+    /**
+     * @param path Path of the asset.
+     * @return Path hash folded to the 32 bits the binary manifest stores.
+     */
+    [[nodiscard]]
+    constexpr uint32_t binary_path_hash(std::string_view const path) noexcept {
+        uint64_t const hash = path_hash(path);
+        return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    /**
+     * Asset as listed by the binary manifest.
+     */
+    struct manifest_record {
+        std::string path;
+        uint32_t crc = 0;
+        uint32_t size = 0;
+        uint32_t offset = 0;
+    };
+
+    /**
+     * Serializes the records into the binary manifest.
+     * @param records Records, the first of duplicate paths wins.
+     * @throws std::runtime_error when the manifest would be too large.
+     * @return Binary manifest.
+     */
+    [[nodiscard]]
+    std::string build_binary_manifest(std::span<manifest_record const> records);
+
+    /**
+     * Binary manifest, used in place without any parsing. Opening it only
+     * validates the header, lookups binary-search the entry table.
+     */
+    class binary_manifest {
+        std::shared_ptr<void const> _owner;
+        std::span<binary_manifest_entry const> _entries;
+        std::string_view _pool;
+
+        binary_manifest(std::span<std::byte const> bytes, std::shared_ptr<void const> owner);
+
+    public:
+        binary_manifest() = default;
+
+        /**
+         * Maps the binary manifest at the path.
+         * @param path Path to the manifest.
+         * @throws std::runtime_error when the file can't be mapped or is not a supported manifest.
+         * @return Manifest.
+         */
+        static binary_manifest open(std::string const& path);
+
+        /**
+         * Uses the binary manifest in memory, taking the ownership of it.
+         * @param bytes Manifest.
+         * @throws std::runtime_error when it is not a supported manifest.
+         * @return Manifest.
+         */
+        static binary_manifest from_bytes(std::string bytes);
+
+        /**
+         * @param path Path of the asset.
+         * @return Entry of the asset, or nullptr if the manifest does not list it.
+         */
+        [[nodiscard]]
+        binary_manifest_entry const* find(std::string_view path) const noexcept;
+
+        //! @return Count of the entries.
+        [[nodiscard]]
+        size_t size() const noexcept { return _entries.size(); }
+
+        //! @return Entry, entries are sorted by the path hash.
+        [[nodiscard]]
+        binary_manifest_entry const& entry(size_t const index) const noexcept { return _entries[index]; }
+
+        //! @return Path of the entry, empty if it lies outside of the string pool.
+        [[nodiscard]]
+        std::string_view path(binary_manifest_entry const& entry) const noexcept {
+            if (entry.path_offset > _pool.size() || entry.path_length > _pool.size() - entry.path_offset)
+                return {};
+            return _pool.substr(entry.path_offset, entry.path_length);
+        }
+    };
+} // namespace libupdate
+
+#endif // LIBUPDATE_MANIFEST_HPP
@@ -0,0 +1,319 @@
+#include "libupdate/download.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <format>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+
+namespace beast = boost::beast; // from <boost/beast.hpp>
+namespace http = beast::http; // from <boost/beast/http.hpp>
+namespace net = boost::asio; // from <boost/asio.hpp>
+namespace ssl = net::ssl; // from <boost/asio/ssl.hpp>
+using tcp = net::ip::tcp; // from <boost/asio/ip/tcp.hpp>
+
+namespace {
+    /**
+     * Keep-alive connection, which serves one request at a time.
+     */
+    class connection {
+    public:
+        using done_handler = std::function<void(connection&, libupdate::download_result&&)>;
+
+        connection(net::io_context& ioc, ssl::context& ssl_ctx, libupdate::server const& origin,
+                   libupdate::download_options const& options, tcp::resolver::results_type const& endpoints,
+                   libupdate::download_stats& stats)
+            : _ioc(ioc), _ssl_ctx(ssl_ctx), _origin(origin), _options(options), _endpoints(endpoints),
+              _stats(stats) {}
+
+        /**
+         * Starts the request, connecting first unless the connection is open.
+         * @param request Request.
+         * @param done    Called with the result, which the connection is free again for.
+         */
+        void request(libupdate::download_request const& request, done_handler done) {
+            _result = {};
+            _result.target = request.target;
+            _done = std::move(done);
+            _attempt = 0;
+
+            _request = {http::verb::get, request.target, 11};
+            _request.set(http::field::host, _origin.host);
+            _request.set(http::field::user_agent, "libupdate");
+            if (!request.if_none_match.empty())
+                _request.set(http::field::if_none_match, request.if_none_match);
+            _request.keep_alive(true);
+            start();
+        }
+
+        /**
+         * Closes the connection, without waiting for the TLS shutdown.
+         */
+        void close() noexcept {
+            if (_tls_stream || _plain_stream) {
+                beast::error_code ec;
+                auto& socket = lowest_layer().socket();
+                socket.shutdown(tcp::socket::shutdown_both, ec);
+                socket.close(ec);
+            }
+            _tls_stream.reset();
+            _plain_stream.reset();
+            _buffer.clear();
+            _connected = false;
+        }
+
+    private:
+        beast::tcp_stream& lowest_layer() {
+            return _tls_stream ? beast::get_lowest_layer(*_tls_stream) : *_plain_stream;
+        }
+
+        template <class Handler>
+        void with_stream(Handler&& handler) {
+            if (_tls_stream)
+                handler(*_tls_stream);
+            else
+                handler(*_plain_stream);
+        }
+
+        void start() {
+            // a pooled connection may have been closed by the server meanwhile,
+            // which the first request over it finds out
+            _reused = _connected;
+            if (_connected)
+                send();
+            else
+                connect();
+        }
+
+        void connect() {
+            close();
+            if (_origin.tls) {
+                _tls_stream.emplace(_ioc, _ssl_ctx);
+                if (!SSL_set_tlsext_host_name(_tls_stream->native_handle(), _origin.host.c_str())) {
+                    fail({static_cast<int>(::ERR_get_error()), net::error::get_ssl_category()}, "server name");
+                    return;
+                }
+            } else {
+                _plain_stream.emplace(_ioc);
+            }
+
+            lowest_layer().expires_after(_options.timeout);
+            lowest_layer().async_connect(_endpoints, [this](beast::error_code const ec, tcp::endpoint const&) {
+                if (ec)
+                    return fail(ec, "connect");
+                _stats.connections++;
+
+                if (!_tls_stream) {
+                    _connected = true;
+                    return send();
+                }
+
+                lowest_layer().expires_after(_options.timeout);
+                _tls_stream->async_handshake(ssl::stream_base::client, [this](beast::error_code const ec) {
+                    if (ec)
+                        return fail(ec, "handshake");
+                    _connected = true;
+                    send();
+                });
+            });
+        }
+
+        void send() {
+            _parser.emplace();
+            _parser->body_limit(_options.body_limit);
+            _stats.requests++;
+
+            lowest_layer().expires_after(_options.timeout);
+            with_stream([this](auto& stream) {
+                http::async_write(stream, _request, [this, &stream](beast::error_code const ec, size_t) {
+                    if (ec)
+                        return fail(ec, "write");
+
+                    lowest_layer().expires_after(_options.timeout);
+                    http::async_read(stream, _buffer, *_parser, [this](beast::error_code const ec, size_t) {
+                        if (ec)
+                            return fail(ec, "read");
+                        receive();
+                    });
+                });
+            });
+        }
+
+        void receive() {
+            auto response = _parser->release();
+            _parser.reset();
+            _result.status = response.result_int();
+            for (auto const& field : response) {
+                _result.headers.emplace_back(std::string(field.name_string().data(), field.name_string().size()),
+                                             std::string(field.value().data(), field.value().size()));
+            }
+            _result.body = std::move(response.body());
+            _stats.bytes += _result.body.size();
+
+            if (!response.keep_alive())
+                close();
+            complete();
+        }
+
+        void fail(beast::error_code const ec, char const* what) {
+            close();
+
+            // a stale pooled connection does not count as an attempt
+            if (_reused || _attempt < _options.retries) {
+                if (!_reused)
+                    _attempt++;
+                _stats.retries++;
+                return start();
+            }
+
+            _result.error = std::format("{}: {}", what, ec.message());
+            complete();
+        }
+
+        void complete() {
+            auto done = std::exchange(_done, {});
+            done(*this, std::move(_result));
+        }
+
+        net::io_context& _ioc;
+        ssl::context& _ssl_ctx;
+        libupdate::server const& _origin;
+        libupdate::download_options const& _options;
+        tcp::resolver::results_type const& _endpoints;
+        libupdate::download_stats& _stats;
+
+        std::optional<beast::ssl_stream<beast::tcp_stream>> _tls_stream;
+        std::optional<beast::tcp_stream> _plain_stream;
+        bool _connected = false;
+        bool _reused = false;
+        unsigned _attempt = 0;
+
+        http::request<http::empty_body> _request;
+        std::optional<http::response_parser<http::string_body>> _parser;
+        beast::flat_buffer _buffer;
+        libupdate::download_result _result;
+        done_handler _done;
+    };
+} // namespace
+
+struct libupdate::downloader::engine {
+    server origin;
+    download_options options;
+    net::io_context ioc;
+    ssl::context ssl_ctx{ssl::context::tlsv12_client};
+    tcp::resolver::results_type endpoints;
+    download_stats stats;
+    std::vector<std::unique_ptr<connection>> pool;
+};
+
+libupdate::downloader::downloader(server origin, download_options options) : _engine(std::make_unique<engine>()) {
+    _engine->origin = std::move(origin);
+    _engine->options = options;
+    _engine->ssl_ctx.set_verify_mode(ssl::verify_none);
+}
+
+libupdate::downloader::~downloader() {
+    close();
+}
+
+std::string_view libupdate::download_result::header(std::string_view const name) const noexcept {
+    beast::string_view const wanted(name.data(), name.size());
+    for (auto const& [field, value] : headers) {
+        if (beast::iequals(beast::string_view(field.data(), field.size()), wanted))
+            return value;
+    }
+    return {};
+}
+
+void libupdate::downloader::fetch(std::span<std::string const> const targets,
+                                  std::function<void(download_result&&)> const& completion) {
+    std::vector<download_request> requests;
+    requests.reserve(targets.size());
+    for (auto const& target : targets)
+        requests.push_back({target});
+    fetch(requests, completion);
+}
+
+void libupdate::downloader::fetch(std::span<download_request const> const requests,
+                                  std::function<void(download_result&&)> const& completion) {
+    if (requests.empty())
+        return;
+
+    auto& engine = *_engine;
+    if (engine.endpoints.empty()) {
+        beast::error_code ec;
+        tcp::resolver resolver(engine.ioc);
+        engine.endpoints = resolver.resolve(engine.origin.host, engine.origin.port, ec);
+        if (ec)
+            throw std::runtime_error(std::format("couldn't resolve '{}': {}", engine.origin.host, ec.message()));
+    }
+
+    // the pool only grows up to the concurrency limit, the connections are kept for later fetches
+    size_t const concurrency = std::min<size_t>(std::max(engine.options.connections, 1u), requests.size());
+    while (engine.pool.size() < concurrency) {
+        engine.pool.push_back(std::make_unique<connection>(
+            engine.ioc, engine.ssl_ctx, engine.origin, engine.options, engine.endpoints, engine.stats));
+    }
+
+    // an exception of the completion stops the fetch once the requests in flight are done
+    size_t next_request = 0;
+    std::exception_ptr error;
+    connection::done_handler done;
+
+    auto const dispatch = [&](connection& conn) {
+        if (!error && next_request < requests.size())
+            conn.request(requests[next_request++], done);
+    };
+
+    done = [&](connection& conn, download_result&& result) {
+        if (!error) {
+            try {
+                completion(std::move(result));
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+        dispatch(conn);
+    };
+
+    for (size_t index = 0; index < concurrency; ++index)
+        dispatch(*engine.pool[index]);
+
+    engine.ioc.restart();
+    engine.ioc.run();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+libupdate::download_result libupdate::downloader::get(std::string const& target, std::string const& if_none_match) {
+    download_request const request{target, if_none_match};
+    download_result result;
+    fetch({&request, 1}, [&result](download_result&& completed) {
+        result = std::move(completed);
+    });
+
+    if (!result.error.empty())
+        throw std::runtime_error(std::format("failed to download '{}': {}", target, result.error));
+    if (result.status != 200 && !(result.status == 304 && !if_none_match.empty()))
+        throw std::runtime_error(std::format("failed to download '{}': status {}", target, result.status));
+    return result;
+}
+
+void libupdate::downloader::close() noexcept {
+    for (auto const& conn : _engine->pool)
+        conn->close();
+}
+
+libupdate::download_stats const& libupdate::downloader::stats() const noexcept {
+    return _engine->stats;
+}
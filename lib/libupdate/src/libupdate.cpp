@@ -1,114 +1,227 @@
 #include "libupdate/libupdate.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <filesystem>
+#include <format>
+#include <fstream>
 #include <iostream>
-#include <boost/beast.hpp>
-#include <boost/asio/ssl.hpp>
-#include <boost/beast/core.hpp>
-#include <boost/beast/http.hpp>
-#include <boost/beast/ssl.hpp>
-#include <boost/beast/version.hpp>
-#include <boost/asio/ip/tcp.hpp>
-#include <boost/asio/ssl/error.hpp>
-#include <boost/asio/ssl/stream.hpp>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
 
 #include "libpak/libpak.hpp"
 
-namespace beast = boost::beast; // from <boost/beast.hpp>
-namespace http = beast::http; // from <boost/beast/http.hpp>
-namespace net = boost::asio; // from <boost/asio.hpp>
-namespace ssl = net::ssl; // from <boost/asio/ssl.hpp>
-using tcp = net::ip::tcp; // from <boost/asio/ip/tcp.hpp>
+namespace {
+    //! Path of the resource being updated.
+    constexpr char const* RESOURCE_PATH = "res.pak";
+    //! Path of the binary manifest, kept next to the resource.
+    constexpr char const* BINARY_MANIFEST_PATH = "res.pak.manifest.bin";
+    //! Path of the entity tag of the binary manifest, which revalidates it.
+    constexpr char const* BINARY_MANIFEST_ETAG_PATH = "res.pak.manifest.bin.etag";
 
-constexpr std::string host = "localhost";
+    //! Directory the downloaded assets are staged in until they are patched into the resource.
+    constexpr char const* DOWNLOAD_PATH = "res.pak.download";
 
-void libupdate::update::update_manifest() {
-    net::io_context ioc;
-    ssl::context ctx(ssl::context::tlsv12_client);
-    ctx.set_verify_mode(ssl::verify_none);
+    //! Path of the applied manifest version, kept next to the resource.
+    constexpr char const* VERSION_PATH = "res.pak.version";
 
-    tcp::resolver resolver(ioc);
-    beast::ssl_stream<beast::tcp_stream> stream(ioc, ctx);
+    //! Target of the binary manifest.
+    constexpr char const* BINARY_MANIFEST_TARGET = "/update/res.pak.manifest.bin";
+    //! Target of the text manifest, the fallback for servers without the binary one.
+    constexpr char const* MANIFEST_TARGET = "/update/res.pak.manifest";
+    //! Target of the delta manifests, followed by the applied version the delta starts from.
+    //! The request is not conditional, the version in the target identifies the client's copy.
+    //! The server answers with the entries changed since that version, in the format of the
+    //! text manifest, and with the version they lead to in the version field. That version
+    //! equals the applied one when nothing changed. A server without a delta from the applied
+    //! version answers not found, and the whole manifest is fetched instead.
+    constexpr char const* DELTA_TARGET = "/update/res.pak.delta/";
+    //! Header field of the manifest responses holding the version of the manifest.
+    constexpr char const* VERSION_FIELD = "X-Manifest-Version";
 
-    if (!SSL_set_tlsext_host_name(stream.native_handle(), host.c_str())) {
-        beast::error_code const ec{static_cast<int>(::ERR_get_error()), net::error::get_ssl_category()};
-        throw beast::system_error{ec};
-    }
+    //! Target the assets are downloaded from, followed by their path.
+    //! The server answers with the decompressed data of the asset.
+    constexpr std::string_view ASSETS_TARGET = "/update/res/";
 
-    auto const results = resolver.resolve(host, "443");
-    beast::get_lowest_layer(stream).connect(results);
+    /**
+     * @param path Path of the asset.
+     * @return Request target of the asset, with the path percent-encoded.
+     */
+    std::string asset_target(std::string_view const path) {
+        std::string target(ASSETS_TARGET);
+        target.reserve(target.size() + path.size());
+        for (char const c : path) {
+            if (std::isalnum(static_cast<unsigned char>(c)) || c == '/' || c == '-' || c == '_' || c == '.' || c == '~')
+                target.push_back(c);
+            else if (c == '\\')
+                target.push_back('/');
+            else
+                target += std::format("%{:02X}", static_cast<unsigned char>(c));
+        }
+        return target;
+    }
 
-    stream.handshake(ssl::stream_base::client);
-    http::request<http::string_body> req{http::verb::get, "/update/res.pak.manifest", 11};
-    req.set(http::field::host, host);
-    req.set(http::field::user_agent, "libupdate");
+    /**
+     * @param path Path of the asset.
+     * @return Path the downloaded asset is staged at, named by the hash of its path.
+     */
+    std::string staged_path(std::string_view const path) {
+        return std::format("{}/{:016x}", DOWNLOAD_PATH, libupdate::path_hash(path));
+    }
 
-    http::write(stream, req);
-    beast::flat_buffer buffer;
-    http::response<http::string_body> resp;
-    http::read(stream, buffer, resp);
+    /**
+     * Replaces the file with the data, through a temporary file so a failed write keeps the old one.
+     * @param path Path of the file.
+     * @param data Data.
+     * @throws std::runtime_error when the file can't be written.
+     */
+    void replace_file(std::string const& path, std::string_view const data) {
+        std::string const temporary_path = path + ".tmp";
+        {
+            std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+            output.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!output.flush())
+                throw std::runtime_error(std::format("couldn't write '{}'", temporary_path));
+        }
+        std::error_code ec;
+        std::filesystem::rename(temporary_path, path, ec);
+        if (ec)
+            throw std::runtime_error(std::format("couldn't replace '{}': {}", path, ec.message()));
+    }
 
-    _manifest.clear();
+    /**
+     * @param path Path of the file.
+     * @return Contents of the file.
+     * @throws std::runtime_error when the file can't be read.
+     */
+    std::vector<std::byte> read_file(std::string const& path) {
+        std::ifstream input(path, std::ios::binary | std::ios::ate);
+        if (!input)
+            throw std::runtime_error(std::format("couldn't open '{}'", path));
+        std::vector<std::byte> data(static_cast<size_t>(input.tellg()));
+        input.seekg(0);
+        if (!input.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())))
+            throw std::runtime_error(std::format("couldn't read '{}'", path));
+        return data;
+    }
 
-    beast::error_code ec;
-    stream.shutdown(ec);
-    if (ec == net::error::eof || ec == ssl::error::stream_truncated) {
-        ec = {};
+    /**
+     * Fetches the request, failures included.
+     * @param downloader Downloader.
+     * @param request    Request.
+     * @return Result.
+     */
+    libupdate::download_result fetch_one(libupdate::downloader& downloader, libupdate::download_request const& request) {
+        libupdate::download_result fetched;
+        downloader.fetch({&request, 1}, [&fetched](libupdate::download_result&& result) {
+            fetched = std::move(result);
+        });
+        return fetched;
     }
-    if (ec) {
-        throw beast::system_error{ec};
+
+    /**
+     * @param result Manifest response.
+     * @return Version of the manifest.
+     */
+    libupdate::manifest_version version_of(libupdate::download_result const& result) {
+        libupdate::manifest_version version;
+        auto const field = result.header(VERSION_FIELD);
+        std::from_chars(field.data(), field.data() + field.size(), version.version);
+        version.etag = result.header("ETag");
+        return version;
     }
 
-    char path[256] = {};
-    char crc[9] = {};
-    size_t offset = 0;
+    /**
+     * @param path Path of the version file.
+     * @return Applied version, or an empty one if there is none.
+     */
+    libupdate::manifest_version load_version(std::string const& path) {
+        libupdate::manifest_version version;
+        std::ifstream input(path);
+        std::string line;
+        if (!std::getline(input, line))
+            return {};
+        auto const [end, ec] = std::from_chars(line.data(), line.data() + line.size(), version.version);
+        if (ec != std::errc{})
+            return {};
+        return version;
+    }
 
-    while (true) {
-        if (offset >= resp.body().size())
-            break;
+    /**
+     * @param path Path of the entity tag file.
+     * @return Entity tag, or an empty one if there is none.
+     */
+    std::string load_etag(std::string const& path) {
+        std::ifstream input(path);
+        std::string etag;
+        std::getline(input, etag);
+        return etag;
+    }
+} // namespace
 
-        memset(path, 0, sizeof(path));
-        memset(crc, 0, sizeof(crc));
+libupdate::update::update(server origin, download_options options)
+    : _downloader(std::make_unique<downloader>(std::move(origin), options)) {}
 
-        // parse path up until the first colon ':'
-        // incrementing the path index, but also the offset from the start of the file
-        for (unsigned index = 0; index < sizeof(path); ++index, ++offset) {
-            if (offset >= resp.body().size()) {
-                throw std::runtime_error("unexpected eof when parsing a path in the manifest");
-            }
-            char const c = resp.body().at(offset);
-            //if (!isalnum(c) && (c != '/' or c != '\\' or c != '_' or c != '-'))
-            //    continue; // ignore invalid character
+bool libupdate::update::update_manifest() {
+    _applied = load_version(VERSION_PATH);
+    _delta.reset();
 
-            if (c == ':')
-                break; // end of path
-            path[index] = c;
+    // clients with an applied version ask only for the entries changed since it, see DELTA_TARGET
+    if (_applied.version != 0) {
+        auto delta = fetch_one(*_downloader, {std::format("{}{}", DELTA_TARGET, _applied.version)});
+        if (delta.ok()) {
+            _fetched = version_of(delta);
+            if (_fetched.version == 0)
+                throw std::runtime_error(std::format("delta manifest '{}' has no {}", delta.target, VERSION_FIELD));
+            if (_fetched.version == _applied.version)
+                return false;
+            _delta = manifest::parse(std::move(delta.body));
+            return true;
         }
+        // the server has no delta from the applied version, the whole manifest is fetched
+    }
 
-        offset += 1;
+    // the copy of the binary manifest next to the resource is revalidated by its own entity tag,
+    // and the resource is compared against it either way
+    std::error_code ec;
+    std::string const etag = std::filesystem::exists(BINARY_MANIFEST_PATH, ec)
+        ? load_etag(BINARY_MANIFEST_ETAG_PATH) : std::string();
+    auto binary = fetch_one(*_downloader, {BINARY_MANIFEST_TARGET, etag});
+    if (binary.not_modified()) {
+        _binary_manifest = binary_manifest::open(BINARY_MANIFEST_PATH);
+        _manifest.clear();
+        _fetched = version_of(binary);
+        return true;
+    }
 
-        for (unsigned index = 0; index < 8; ++index, ++offset) {
-            if (offset >= resp.body().size()) {
-                throw std::runtime_error("unexpected eof when parsing manifest, missing crc");
-            }
-            crc[index] = resp.body().at(offset);
-        }
-        // since uint32_t is larger than int we must first parse it as long long
-        // and then cast it to uint32_t
-        long long crc_l;
-        try {
-            crc_l = std::stoll(std::string(crc), nullptr, 16); //TODO: sto(uint32_t)?
-        } catch (std::invalid_argument const& ex)
-        {
-           throw std::runtime_error(std::format("invalid crc for '{}'", std::string(path)));
-        }
-        catch (std::out_of_range const& ex)
-        {
-           throw std::runtime_error(std::format("invalid crc for '{}' - out of range", std::string(path)));
-        }
-        auto crc_i = static_cast<uint32_t>(crc_l);
-        _manifest.emplace(std::string(path), crc_i);
-        ++offset; // ignore then newline at the end of the line
+    // the binary manifest is stored next to the resource and mapped, without any parsing;
+    // its entity tag is stored after it, so a stale tag never revalidates a newer copy
+    if (binary.ok()) {
+        replace_file(BINARY_MANIFEST_PATH, binary.body);
+        _fetched = version_of(binary);
+        replace_file(BINARY_MANIFEST_ETAG_PATH, _fetched.etag);
+        _binary_manifest = binary_manifest::open(BINARY_MANIFEST_PATH);
+        _manifest.clear();
+        return true;
+    }
+
+    auto response = _downloader->get(MANIFEST_TARGET);
+    _fetched = version_of(response);
+    _manifest = manifest::parse(std::move(response.body));
+    _binary_manifest.reset();
+    return true;
+}
+
+std::optional<uint32_t> libupdate::update::manifest_crc(std::string_view const path) const noexcept {
+    if (_binary_manifest) {
+        if (auto const* entry = _binary_manifest->find(path))
+            return entry->crc;
+        return std::nullopt;
     }
+    return _manifest.find(path);
 }
 
 libupdate::progress libupdate::update::get_progress() const noexcept {
@@ -118,25 +231,126 @@ libupdate::progress libupdate::update::get_progress() const noexcept {
 
 void libupdate::update::initiate() {
     _progress.state = CHECK;
-    update_manifest();
+    if (!update_manifest()) {
+        // nothing changed since the applied version
+        _marked.clear();
+        return;
+    }
 
-    auto r = libpak::resource("res.pak");
-    r.read(false);
     std::vector<std::string> marked {};
+    {
+        auto r = libpak::resource(RESOURCE_PATH);
+        r.read_compact();
+
+        if (_delta) {
+            // only the entries of the delta may differ
+            for (size_t index = 0; index < _delta->size(); ++index) {
+                auto const entry = r.index.find(_delta->path(index));
+                if (!entry || r.index.crc_embedded(*entry) != _delta->crc(index))
+                    marked.emplace_back(_delta->path(index));
+            }
+        } else {
+            for (uint32_t entry = 0; entry < r.index.size(); ++entry) {
+                // a duplicate path is compared once, by the entry the resource keeps
+                if (r.index.has_flag(entry, libpak::compact_index::SHADOWED))
+                    continue;
+                std::string path = libpak::path_index::to_utf8(r.index.path(entry));
+                auto const crc = manifest_crc(path);
+                if (!crc || *crc != r.index.crc_embedded(entry))
+                    marked.emplace_back(std::move(path));
+            }
+        }
+    }
+
+    _marked = std::move(marked);
+    download_marked();
+    patch_marked();
+
+    // the fetched version is persisted as applied only now that the resource
+    // is patched, so an interrupted update compares the resource again; an
+    // unversioned manifest leaves no version to ask a delta from
+    if (_fetched.version != 0) {
+        replace_file(VERSION_PATH, std::format("{}\n", _fetched.version));
+    } else {
+        std::error_code ec;
+        std::filesystem::remove(VERSION_PATH, ec);
+    }
+    _applied = _fetched;
+}
+
+void libupdate::update::download_marked() {
+    _progress = {DOWNLOAD, 0};
+
+    std::map<std::string, std::string_view> paths;
+    std::vector<std::string> targets;
+    targets.reserve(_marked.size());
+    for (auto const& path : _marked) {
+        targets.emplace_back(asset_target(path));
+        paths.emplace(targets.back(), path);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(DOWNLOAD_PATH, ec);
+    if (ec)
+        throw std::runtime_error(std::format("couldn't create '{}': {}", DOWNLOAD_PATH, ec.message()));
+
+    // the assets download concurrently over the pooled connections, and each
+    // is staged on the disk as it completes so only those in flight are held
+    size_t downloaded = 0;
+    _downloader->fetch(targets, [&](download_result&& result) {
+        if (!result.ok()) {
+            throw std::runtime_error(std::format("failed to download '{}': {}", result.target,
+                result.error.empty() ? std::format("status {}", result.status) : result.error));
+        }
+        replace_file(staged_path(paths.at(result.target)), result.body);
+
+        std::scoped_lock lock(_mutex);
+        _progress.percentage = 100.0 * static_cast<double>(++downloaded) / static_cast<double>(targets.size());
+    });
+}
 
-    for (auto &[path, asset]  : r.assets) {
-        if (!_manifest.contains(path)) {
-            marked.emplace_back(path);
-            continue;
+void libupdate::update::patch_marked() {
+    _progress = {UPDATE, 0};
+
+    if (!_marked.empty()) {
+        auto r = libpak::resource(RESOURCE_PATH);
+        r.read();
+
+        size_t patched = 0;
+        for (auto const& path : _marked) {
+            auto data = read_file(staged_path(path));
+
+            auto* asset = r.find(path);
+            if (asset == nullptr) {
+                // an asset the resource does not have yet is added to it
+                libpak::asset added;
+                auto const utf16_path = libpak::path_index::to_utf16(path);
+                if (utf16_path.size() >= std::size(added.header.path))
+                    throw std::runtime_error(std::format("asset path '{}' is too long", path));
+                std::ranges::copy(utf16_path, added.header.path);
+                added.header.asset_magic = 0x1;
+                added.header.is_asset_embedded = 1;
+                added.header.is_data_compressed = 1;
+                asset = &r.assets.emplace(path, std::move(added)).first->second;
+            }
+            asset->header.data_decompressed_length = static_cast<uint32_t>(data.size());
+            asset->data.own(std::move(data));
+
+            std::scoped_lock lock(_mutex);
+            _progress.percentage = 100.0 * static_cast<double>(++patched) / static_cast<double>(_marked.size());
         }
 
-        if (_manifest[path] != asset.header.crc_embedded) {
-            marked.emplace_back(path);
-            continue;
+        // the assets are patched in place, unless the header table has no room for the added ones
+        try {
+            r.write_incremental();
+        } catch (std::runtime_error const&) {
+            r.write();
         }
     }
 
-    assert(marked.empty());
+    // the staged assets are only removed once the resource holds them
+    std::error_code ec;
+    std::filesystem::remove_all(DOWNLOAD_PATH, ec);
 }
 
 void libupdate::update::terminate() {
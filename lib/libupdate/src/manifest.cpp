@@ -0,0 +1,184 @@
+#include "libupdate/manifest.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+#include "libpak/io.hpp"
+
+static_assert(std::endian::native == std::endian::little, "the binary manifest is little-endian");
+
+libupdate::manifest libupdate::manifest::parse(std::string text) {
+    if (text.size() > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("manifest is too large");
+
+    manifest result;
+    result._text = std::move(text);
+    std::string_view const body = result._text;
+
+    // one entry per line, so the table is allocated once
+    result._entries.reserve(std::ranges::count(body, '\n') + 1);
+
+    size_t line_number = 0;
+    for (size_t offset = 0; offset < body.size();) {
+        ++line_number;
+        size_t line_end = body.find('\n', offset);
+        if (line_end == std::string_view::npos)
+            line_end = body.size();
+        std::string_view line = body.substr(offset, line_end - offset);
+        size_t const line_offset = offset;
+        offset = line_end + 1;
+
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (line.empty())
+            continue;
+
+        // the path ends at the last colon, the crc holds none
+        size_t const colon = line.rfind(':');
+        if (colon == std::string_view::npos || colon == 0)
+            throw std::runtime_error(std::format("missing path or crc on manifest line {}", line_number));
+
+        // the crc may be padded with spaces
+        std::string_view crc_text = line.substr(colon + 1);
+        crc_text.remove_prefix(std::min(crc_text.find_first_not_of(' '), crc_text.size()));
+
+        uint32_t crc = 0;
+        auto const [end, ec] = std::from_chars(crc_text.data(), crc_text.data() + crc_text.size(), crc, 16);
+        if (ec != std::errc{} || end != crc_text.data() + crc_text.size() || crc_text.empty()) {
+            throw std::runtime_error(
+                std::format("invalid crc for '{}' on manifest line {}", line.substr(0, colon), line_number));
+        }
+
+        result._entries.push_back(
+            {path_hash(line.substr(0, colon)), static_cast<uint32_t>(line_offset), static_cast<uint32_t>(colon), crc});
+    }
+
+    // sorted for the binary search, duplicate paths by their position so the first one stays
+    std::ranges::sort(result._entries, [&result](entry const& left, entry const& right) {
+        if (left.hash != right.hash)
+            return left.hash < right.hash;
+        int const order = result.path_of(left).compare(result.path_of(right));
+        return order != 0 ? order < 0 : left.path_offset < right.path_offset;
+    });
+    auto const duplicates = std::ranges::unique(result._entries, [&result](entry const& left, entry const& right) {
+        return left.hash == right.hash && result.path_of(left) == result.path_of(right);
+    });
+    result._entries.erase(duplicates.begin(), duplicates.end());
+    return result;
+}
+
+std::optional<uint32_t> libupdate::manifest::find(std::string_view const path) const noexcept {
+    auto const hash = path_hash(path);
+    auto found = std::ranges::lower_bound(_entries, hash, {}, &entry::hash);
+    for (; found != _entries.end() && found->hash == hash; ++found) {
+        if (path_of(*found) == path)
+            return found->crc;
+    }
+    return std::nullopt;
+}
+
+std::string libupdate::build_binary_manifest(std::span<manifest_record const> const records) {
+    if (records.size() > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("too many manifest records");
+
+    // entries sorted by the hash, colliding paths by the path, duplicates by the position
+    std::vector<std::pair<uint32_t, uint32_t>> order;
+    order.reserve(records.size());
+    for (uint32_t index = 0; index < records.size(); ++index) {
+        if (records[index].path.size() > std::numeric_limits<uint16_t>::max())
+            throw std::runtime_error(std::format("manifest path '{}' is too long", records[index].path));
+        order.emplace_back(binary_path_hash(records[index].path), index);
+    }
+    std::ranges::sort(order, [&records](auto const& left, auto const& right) {
+        if (left.first != right.first)
+            return left.first < right.first;
+        int const compared = records[left.second].path.compare(records[right.second].path);
+        return compared != 0 ? compared < 0 : left.second < right.second;
+    });
+    auto const duplicates = std::ranges::unique(order, [&records](auto const& left, auto const& right) {
+        return left.first == right.first && records[left.second].path == records[right.second].path;
+    });
+    order.erase(duplicates.begin(), duplicates.end());
+
+    binary_manifest_header header;
+    header.entry_count = static_cast<uint32_t>(order.size());
+    header.pool_offset = sizeof(binary_manifest_header) + order.size() * sizeof(binary_manifest_entry);
+    for (auto const& [hash, index] : order)
+        header.pool_size += records[index].path.size();
+    if (header.pool_size > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("manifest paths are too large");
+
+    std::string manifest(header.pool_offset + header.pool_size, '\0');
+    std::memcpy(manifest.data(), &header, sizeof header);
+
+    uint64_t entry_offset = sizeof(binary_manifest_header);
+    uint64_t path_offset = 0;
+    for (auto const& [hash, index] : order) {
+        auto const& record = records[index];
+        binary_manifest_entry const entry{
+            hash,
+            static_cast<uint32_t>(path_offset),
+            record.crc,
+            record.size,
+            record.offset,
+            static_cast<uint16_t>(record.path.size()),
+            0,
+        };
+        std::memcpy(manifest.data() + entry_offset, &entry, sizeof entry);
+        std::memcpy(manifest.data() + header.pool_offset + path_offset, record.path.data(), record.path.size());
+        entry_offset += sizeof entry;
+        path_offset += record.path.size();
+    }
+    return manifest;
+}
+
+libupdate::binary_manifest::binary_manifest(std::span<std::byte const> const bytes, std::shared_ptr<void const> owner)
+    : _owner(std::move(owner)) {
+    binary_manifest_header header;
+    if (bytes.size() < sizeof header)
+        throw std::runtime_error("binary manifest is truncated");
+    std::memcpy(&header, bytes.data(), sizeof header);
+
+    if (header.magic != BINARY_MANIFEST_MAGIC)
+        throw std::runtime_error("not a binary manifest");
+    if (header.version != BINARY_MANIFEST_VERSION)
+        throw std::runtime_error(std::format("unsupported binary manifest version {}", header.version));
+
+    uint64_t const table_size = static_cast<uint64_t>(header.entry_count) * sizeof(binary_manifest_entry);
+    if (table_size > bytes.size() - sizeof header || header.pool_offset > bytes.size()
+        || header.pool_size > bytes.size() - header.pool_offset)
+        throw std::runtime_error("binary manifest is truncated");
+    if (reinterpret_cast<uintptr_t>(bytes.data()) % alignof(binary_manifest_entry) != 0)
+        throw std::runtime_error("binary manifest is misaligned");
+
+    // the paths are validated when they are looked up, so the open does not depend on the size
+    _entries = {reinterpret_cast<binary_manifest_entry const*>(bytes.data() + sizeof header), header.entry_count};
+    _pool = {reinterpret_cast<char const*>(bytes.data() + header.pool_offset), header.pool_size};
+}
+
+libupdate::binary_manifest libupdate::binary_manifest::open(std::string const& path) {
+    auto mapping = std::make_shared<libpak::mapped_file>(path);
+    std::span<std::byte const> const bytes{mapping->data(), mapping->size()};
+    return {bytes, std::move(mapping)};
+}
+
+libupdate::binary_manifest libupdate::binary_manifest::from_bytes(std::string bytes) {
+    auto owner = std::make_shared<std::string>(std::move(bytes));
+    auto const bytes_view = std::as_bytes(std::span(*owner));
+    return {bytes_view, std::move(owner)};
+}
+
+libupdate::binary_manifest_entry const* libupdate::binary_manifest::find(std::string_view const path) const noexcept {
+    auto const hash = binary_path_hash(path);
+    auto found = std::ranges::lower_bound(_entries, hash, {}, &binary_manifest_entry::path_hash);
+    for (; found != _entries.end() && found->path_hash == hash; ++found) {
+        if (this->path(*found) == path)
+            return &*found;
+    }
+    return nullptr;
+}
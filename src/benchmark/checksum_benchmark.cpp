@@ -0,0 +1,63 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <zlib.h>
+
+#include "libpak/algorithms.hpp"
+
+namespace {
+
+/**
+ * Hashes the buffer the way write_asset_data did before the fused digest,
+ * one pass for the CRC and another for the checksum.
+ */
+libpak::alg::digest two_pass(const char* buffer, const uint64_t length) {
+    const auto crc = static_cast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(buffer), length));
+    const auto checksum = libpak::alg::alicia_checksum(buffer, length);
+    return {crc, checksum};
+}
+
+template <typename Func>
+double measure(const std::vector<char>& buffer, const int iterations, libpak::alg::digest& digest,
+               Func&& func) {
+    const auto begin = std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < iterations; ++iteration)
+        digest = func(buffer.data(), buffer.size());
+    const auto end = std::chrono::steady_clock::now();
+
+    const double seconds = std::chrono::duration<double>(end - begin).count();
+    return static_cast<double>(buffer.size()) * iterations / seconds / (1024.0 * 1024 * 1024);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // total bytes hashed per buffer size
+    const uint64_t volume = (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4096) * 1024 * 1024;
+
+    std::mt19937 generator(0x616C6963);
+    printf("%12s %14s %14s %8s\n", "size", "two-pass GB/s", "fused GB/s", "speedup");
+
+    for (const uint64_t size : {4ull << 10, 64ull << 10, 1ull << 20, 16ull << 20, 256ull << 20}) {
+        std::vector<char> buffer(size);
+        for (auto& byte : buffer)
+            byte = static_cast<char>(generator());
+
+        const int iterations = static_cast<int>(std::max<uint64_t>(1, volume / size));
+        libpak::alg::digest two_pass_digest{};
+        libpak::alg::digest fused_digest{};
+        const double two_pass_rate = measure(buffer, iterations, two_pass_digest, two_pass);
+        const double fused_rate = measure(buffer, iterations, fused_digest, libpak::alg::crc32_checksum);
+
+        if (two_pass_digest.crc != fused_digest.crc || two_pass_digest.checksum != fused_digest.checksum) {
+            fprintf(stderr, "digest mismatch for %llu bytes\n", static_cast<unsigned long long>(size));
+            return 1;
+        }
+
+        printf("%12llu %14.2f %14.2f %7.2fx\n", static_cast<unsigned long long>(size), two_pass_rate,
+               fused_rate, fused_rate / two_pass_rate);
+    }
+}
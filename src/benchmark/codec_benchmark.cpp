@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ranges>
+#include <span>
+#include <vector>
+
+#include "generator.hpp"
+#include "libpak/codec.hpp"
+
+namespace {
+
+struct payload {
+    std::span<const std::byte> data;
+    std::vector<std::byte> compressed;
+};
+
+double seconds_since(const std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const int level = argc > 1 ? std::atoi(argv[1]) : 9;
+
+    benchmark::generator_options options;
+    options.asset_count = 2000;
+    options = benchmark::parse_options(argc, argv, options);
+
+    libpak::resource resource("");
+    const uint64_t total_size = benchmark::generate_assets(resource, options);
+    printf("%u payloads, %.1f MiB, level %d\n", options.asset_count, total_size / (1024.0 * 1024), level);
+    printf("%-12s %8s %16s %16s\n", "codec", "ratio", "compress MB/s", "inflate MB/s");
+
+    const auto& reference = libpak::get_codec(libpak::codec_backend::zlib);
+    for (const auto backend : {libpak::codec_backend::zlib, libpak::codec_backend::libdeflate}) {
+        if (!libpak::is_codec_available(backend))
+            continue;
+        const auto& codec = libpak::get_codec(backend);
+
+        std::vector<payload> payloads;
+        for (const auto& asset : resource.assets | std::views::values)
+            payloads.push_back({asset.data.bytes(), {}});
+
+        uint64_t compressed_size = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (auto& payload : payloads) {
+            payload.compressed.resize(codec.compress_bound(payload.data.size()));
+            payload.compressed.resize(codec.compress(payload.data, payload.compressed, level));
+            compressed_size += payload.compressed.size();
+        }
+        const double compress_seconds = seconds_since(begin);
+
+        std::vector<std::byte> output(options.max_size);
+        begin = std::chrono::steady_clock::now();
+        for (const auto& payload : payloads)
+            codec.decompress(payload.compressed, output);
+        const double inflate_seconds = seconds_since(begin);
+
+        // the streams must stay readable by zlib, which the game uses
+        for (const auto& payload : payloads) {
+            const uint64_t size = reference.decompress(payload.compressed, output);
+            if (!std::ranges::equal(std::span(output).first(size), payload.data)) {
+                fprintf(stderr, "%.*s stream does not round trip through zlib\n",
+                        static_cast<int>(codec.name().size()), codec.name().data());
+                return 1;
+            }
+        }
+
+        printf("%-12.*s %8.3f %16.1f %16.1f\n", static_cast<int>(codec.name().size()), codec.name().data(),
+               static_cast<double>(compressed_size) / total_size, total_size / compress_seconds / 1e6,
+               total_size / inflate_seconds / 1e6);
+    }
+}
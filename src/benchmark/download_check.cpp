@@ -0,0 +1,191 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include "libupdate/download.hpp"
+
+namespace beast = boost::beast; // from <boost/beast.hpp>
+namespace http = beast::http; // from <boost/beast/http.hpp>
+namespace net = boost::asio; // from <boost/asio.hpp>
+using tcp = net::ip::tcp; // from <boost/asio/ip/tcp.hpp>
+
+namespace {
+
+//! Entity tag of every response of the loopback server.
+constexpr char const* ETAG = "\"loopback\"";
+
+/**
+ * @param target Request target.
+ * @return Body the loopback server answers the target with.
+ */
+std::string body_of(std::string_view const target) {
+    std::string body;
+    for (unsigned repeat = 0; repeat < 1 + target.size() % 64; ++repeat)
+        body += target;
+    return body;
+}
+
+/**
+ * Plain HTTP server on the loopback interface, one thread per connection.
+ * Targets under "/missing" are not found, and a request matching the entity
+ * tag is not modified.
+ */
+class loopback_server {
+public:
+    /**
+     * @param close_every Count of the responses after which the server closes the
+     *                    connection, zero to keep the connections alive.
+     */
+    explicit loopback_server(unsigned const close_every)
+        : _acceptor(_ioc, {net::ip::make_address("127.0.0.1"), 0}), _close_every(close_every) {
+        _thread = std::thread([this] { accept(); });
+    }
+
+    ~loopback_server() {
+        _stopping = true;
+        beast::error_code ec;
+        tcp::socket wakeup(_ioc);
+        wakeup.connect(_acceptor.local_endpoint(), ec);
+        _thread.join();
+    }
+
+    [[nodiscard]]
+    std::string port() const { return std::to_string(_acceptor.local_endpoint().port()); }
+
+    //! @return Count of the accepted connections.
+    [[nodiscard]]
+    unsigned accepted() const noexcept { return _accepted; }
+
+private:
+    void accept() {
+        std::vector<std::thread> connections;
+        while (true) {
+            tcp::socket socket(_ioc);
+            beast::error_code ec;
+            _acceptor.accept(socket, ec);
+            if (ec || _stopping)
+                break;
+            ++_accepted;
+            connections.emplace_back([this, socket = std::move(socket)]() mutable { serve(socket); });
+        }
+        for (auto& connection : connections)
+            connection.join();
+    }
+
+    void serve(tcp::socket& socket) const {
+        beast::flat_buffer buffer;
+        for (unsigned served = 1;; ++served) {
+            http::request<http::empty_body> request;
+            beast::error_code ec;
+            http::read(socket, buffer, request, ec);
+            if (ec)
+                return;
+
+            std::string_view const target(request.target().data(), request.target().size());
+            http::response<http::string_body> response{http::status::ok, request.version()};
+            response.set(http::field::etag, ETAG);
+            if (target.starts_with("/missing")) {
+                response.result(http::status::not_found);
+            } else if (request[http::field::if_none_match] == ETAG) {
+                response.result(http::status::not_modified);
+            } else {
+                response.body() = body_of(target);
+            }
+
+            bool const last = _close_every != 0 && served % _close_every == 0;
+            response.keep_alive(!last);
+            response.prepare_payload();
+            http::write(socket, response, ec);
+            if (ec || last)
+                return;
+        }
+    }
+
+    net::io_context _ioc;
+    tcp::acceptor _acceptor;
+    unsigned const _close_every;
+    std::atomic<bool> _stopping = false;
+    std::atomic<unsigned> _accepted = 0;
+    std::thread _thread;
+};
+
+/**
+ * Fetches the targets through a fresh downloader and checks every body.
+ * @param close_every Count of the responses after which the server closes the connection.
+ * @param count       Count of the targets.
+ * @return Whether every target arrived intact.
+ */
+bool check_fetch(unsigned const close_every, unsigned const count) {
+    loopback_server server(close_every);
+    libupdate::download_options options;
+    options.connections = 4;
+    options.timeout = std::chrono::seconds(5);
+    libupdate::downloader downloader({"127.0.0.1", server.port(), false}, options);
+
+    std::vector<std::string> targets;
+    for (unsigned index = 0; index < count; ++index)
+        targets.push_back(std::format("/update/res/asset{}", index));
+
+    auto const begin = std::chrono::steady_clock::now();
+    unsigned intact = 0;
+    downloader.fetch(targets, [&](libupdate::download_result&& result) {
+        if (result.ok() && result.body == body_of(result.target))
+            ++intact;
+        else
+            printf("  %s: status %u %s\n", result.target.c_str(), result.status, result.error.c_str());
+    });
+    double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    auto const& stats = downloader.stats();
+    printf("close every %u: %u of %u intact, %llu connections, %llu requests, %llu retries, %.3f s\n",
+           close_every, intact, count, static_cast<unsigned long long>(stats.connections),
+           static_cast<unsigned long long>(stats.requests), static_cast<unsigned long long>(stats.retries), elapsed);
+
+    // keep-alive connections are reused for every target once established
+    bool const pooled = close_every != 0 || stats.connections <= options.connections;
+    return intact == count && pooled;
+}
+
+/**
+ * Checks the single fetches, failures and the revalidation.
+ * @return Whether the results are as expected.
+ */
+bool check_get() {
+    loopback_server server(0);
+    libupdate::downloader downloader({"127.0.0.1", server.port(), false});
+
+    auto const fetched = downloader.get("/update/res.pak.manifest");
+    auto const revalidated = downloader.get("/update/res.pak.manifest", ETAG);
+    bool missing_throws = false;
+    try {
+        (void) downloader.get("/missing");
+    } catch (std::runtime_error const&) {
+        missing_throws = true;
+    }
+
+    bool const ok = fetched.ok() && fetched.header("etag") == ETAG && revalidated.not_modified() && missing_throws;
+    printf("get: %s\n", ok ? "ok" : "failed");
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned const count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+
+    bool ok = check_fetch(0, count);
+    ok = check_fetch(7, count) && ok;
+    ok = check_get() && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
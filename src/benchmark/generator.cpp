@@ -0,0 +1,108 @@
+#include "generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <string_view>
+
+namespace {
+    //! Extensions of the generated assets.
+    constexpr std::u16string_view extensions[] = {u"dds", u"ogg", u"png", u"xml", u"lua", u"bin"};
+
+    //! Size of a block that is either random or a repeated pattern.
+    constexpr uint64_t block_size = 64;
+
+    uint64_t generate_size(benchmark::random& random, benchmark::generator_options const& options) {
+        if (options.max_size <= options.min_size)
+            return options.min_size;
+
+        if (options.distribution == benchmark::size_distribution::uniform)
+            return options.min_size + random.next() % (options.max_size - options.min_size + 1);
+
+        double const low = std::log(static_cast<double>(std::max<uint64_t>(options.min_size, 1)));
+        double const high = std::log(static_cast<double>(options.max_size));
+        auto const size = static_cast<uint64_t>(std::exp(low + (high - low) * random.uniform()));
+        return std::clamp(size, options.min_size, options.max_size);
+    }
+
+    void generate_payload(benchmark::random& random, double const compressibility, std::vector<std::byte>& payload) {
+        for (uint64_t offset = 0; offset < payload.size(); offset += block_size) {
+            uint64_t const length = std::min(block_size, payload.size() - offset);
+            if (random.uniform() < compressibility) {
+                // short repeated pattern, deflate shrinks it well
+                uint64_t const pattern = random.next() % 4;
+                for (uint64_t index = 0; index < length; ++index)
+                    payload[offset + index] = static_cast<std::byte>('a' + (index + pattern) % 8);
+            } else {
+                for (uint64_t index = 0; index < length; index += 8) {
+                    uint64_t const value = random.next();
+                    std::memcpy(&payload[offset + index], &value, std::min<uint64_t>(8, length - index));
+                }
+            }
+        }
+    }
+} // namespace
+
+uint64_t benchmark::generate_assets(libpak::resource& resource, generator_options const& options) {
+    random random(options.seed);
+    uint64_t total_size = 0;
+
+    resource.assets.reserve(options.asset_count);
+    for (uint32_t index = 0; index < options.asset_count; ++index) {
+        libpak::asset asset;
+
+        auto const& extension = extensions[random.next() % std::size(extensions)];
+        std::string const name = std::format("generated/{:03}/{:08}.", index % 512, index);
+        std::u16string path(name.begin(), name.end());
+        path.append(extension);
+        std::ranges::copy(path, asset.header.path);
+
+        std::vector<std::byte> payload(generate_size(random, options));
+        generate_payload(random, options.compressibility, payload);
+        total_size += payload.size();
+
+        asset.header.asset_magic = 0x1;
+        asset.header.is_asset_embedded = 1;
+        asset.header.is_data_compressed = random.uniform() < options.compressed_fraction;
+        asset.header.data_decompressed_length = payload.size();
+        asset.data.own(std::move(payload));
+
+        resource.assets[asset.path()] = std::move(asset);
+    }
+    return total_size;
+}
+
+uint64_t benchmark::generate_pak(std::string const& path, generator_options const& options) {
+    libpak::resource resource(path);
+    uint64_t const total_size = generate_assets(resource, options);
+    resource.write();
+    return total_size;
+}
+
+benchmark::generator_options benchmark::parse_options(int const argc, char** const argv, generator_options options) {
+    for (int index = 1; index + 1 < argc; ++index) {
+        std::string_view const argument = argv[index];
+        char const* const value = argv[index + 1];
+        if (argument == "--assets")
+            options.asset_count = std::strtoul(value, nullptr, 10);
+        else if (argument == "--min-size")
+            options.min_size = std::strtoull(value, nullptr, 10);
+        else if (argument == "--max-size")
+            options.max_size = std::strtoull(value, nullptr, 10);
+        else if (argument == "--distribution")
+            options.distribution = std::string_view(value) == "uniform"
+                ? size_distribution::uniform
+                : size_distribution::log_uniform;
+        else if (argument == "--compressibility")
+            options.compressibility = std::strtod(value, nullptr);
+        else if (argument == "--compressed")
+            options.compressed_fraction = std::strtod(value, nullptr);
+        else if (argument == "--seed")
+            options.seed = std::strtoull(value, nullptr, 0);
+        else
+            continue;
+        ++index;
+    }
+    return options;
+}
@@ -0,0 +1,89 @@
+#ifndef BENCHMARK_GENERATOR_HPP
+#define BENCHMARK_GENERATOR_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "libpak/libpak.hpp"
+
+namespace benchmark {
+    /**
+     * Distribution of the generated payload sizes.
+     */
+    enum class size_distribution {
+        //! Sizes uniformly distributed between the bounds.
+        uniform,
+        //! Sizes uniformly distributed in log space, most payloads are small.
+        log_uniform,
+    };
+
+    /**
+     * Options of the synthetic pak generator.
+     */
+    struct generator_options {
+        //! Count of generated assets.
+        uint32_t asset_count = 10000;
+        //! Smallest payload size.
+        uint64_t min_size = 256;
+        //! Largest payload size.
+        uint64_t max_size = 256 * 1024;
+        //! Distribution of the payload sizes.
+        size_distribution distribution = size_distribution::log_uniform;
+        //! Fraction of each payload made of repeated patterns, from 0 (random) to 1.
+        double compressibility = 0.5;
+        //! Fraction of assets stored compressed.
+        double compressed_fraction = 0.5;
+        //! Seed, the same seed and options always produce the same pak.
+        uint64_t seed = 0x616C696369610000;
+    };
+
+    /**
+     * Deterministic splitmix64 random generator.
+     */
+    class random {
+    public:
+        explicit random(uint64_t const seed) noexcept : state(seed) {}
+
+        uint64_t next() noexcept {
+            uint64_t z = (state += 0x9E3779B97F4A7C15);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+            return z ^ (z >> 31);
+        }
+
+        //! @return Uniform real number in [0, 1).
+        double uniform() noexcept { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+    private:
+        uint64_t state;
+    };
+
+    /**
+     * Fills the resource with generated assets.
+     * @param resource Resource.
+     * @param options  Generator options.
+     * @return Total size of the generated payloads.
+     */
+    uint64_t generate_assets(libpak::resource& resource, generator_options const& options);
+
+    /**
+     * Generates a pak at the path.
+     * @param path    Path of the pak.
+     * @param options Generator options.
+     * @return Total size of the generated payloads.
+     */
+    uint64_t generate_pak(std::string const& path, generator_options const& options);
+
+    /**
+     * Parses generator options from command line arguments of the form
+     * `--assets N --min-size N --max-size N --distribution uniform|log
+     * --compressibility X --compressed X --seed N`. Unknown arguments are skipped.
+     * @param argc    Argument count.
+     * @param argv    Arguments.
+     * @param options Options to start from.
+     * @return Generator options.
+     */
+    generator_options parse_options(int argc, char** argv, generator_options options = {});
+} // namespace benchmark
+
+#endif // BENCHMARK_GENERATOR_HPP
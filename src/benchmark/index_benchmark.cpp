@@ -0,0 +1,114 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "generator.hpp"
+#include "libpak/libpak.hpp"
+
+namespace {
+
+/**
+ * Evicts the file from the page cache so the next read is cold.
+ * @param path Path to the file.
+ */
+void drop_page_cache(const std::string& path) {
+    const int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return;
+    posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED);
+    close(descriptor);
+}
+
+/**
+ * Indexes the resource the way libpak did before the bulk header read,
+ * one seek and one read per asset header.
+ * @param path Path to the resource.
+ * @return Count of indexed assets.
+ */
+size_t index_per_asset(const std::string& path) {
+    libpak::resource resource(path);
+    libpak::stream stream(std::make_shared<std::ifstream>(path, std::ios::binary), nullptr);
+
+    stream.read(resource.pak_header);
+    stream.set_reader_cursor(libpak::PAK_CONTENT_SECTOR);
+    stream.read(resource.content_header);
+
+    resource.assets.reserve(resource.content_header.assets_count);
+    for (uint32_t index = 0; index < resource.content_header.assets_count; ++index) {
+        libpak::asset asset;
+        if (!stream.read(asset.header) || asset.header.asset_magic == 0x0)
+            throw std::runtime_error("invalid asset header read");
+        resource.assets[asset.path()] = std::move(asset);
+    }
+    return resource.assets.size();
+}
+
+/**
+ * Indexes the resource with the given backend.
+ * @param path Path to the resource.
+ * @param backend Backend.
+ * @return Count of indexed assets.
+ */
+size_t index_bulk(const std::string& path, const libpak::backend backend) {
+    libpak::resource resource(path);
+    resource.resource_backend = backend;
+    resource.read(false);
+    return resource.assets.size();
+}
+
+void run(const char* name, const std::string& path, const int iterations, bool cold,
+         const std::function<size_t()>& func) {
+    double total_ms = 0;
+    size_t count = 0;
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        if (cold)
+            drop_page_cache(path);
+        const auto begin = std::chrono::steady_clock::now();
+        count = func();
+        const auto end = std::chrono::steady_clock::now();
+        total_ms += std::chrono::duration<double, std::milli>(end - begin).count();
+    }
+    printf("%-24s %-5s %8zu assets %10.3f ms\n", name, cold ? "cold" : "warm", count,
+           total_ms / iterations);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <pak> [iterations]\n", argv[0]);
+        fprintf(stderr, "       %s --generate <pak> [iterations] [generator options]\n", argv[0]);
+        return 1;
+    }
+
+    const bool generate = std::string_view(argv[1]) == "--generate";
+    if (generate && argc < 3) {
+        fprintf(stderr, "missing path of the generated pak\n");
+        return 1;
+    }
+
+    const std::string path = generate ? argv[2] : argv[1];
+    const int iterations_index = generate ? 3 : 2;
+    const int iterations = argc > iterations_index ? std::atoi(argv[iterations_index]) : 5;
+
+    if (generate)
+        benchmark::generate_pak(path, benchmark::parse_options(argc, argv));
+
+    for (const bool cold : {true, false}) {
+        run("per-asset header read", path, iterations, cold,
+            [&] { return index_per_asset(path); });
+        run("bulk header read", path, iterations, cold,
+            [&] { return index_bulk(path, libpak::backend::stream); });
+        run("mapped header read", path, iterations, cold,
+            [&] { return index_bulk(path, libpak::backend::mapped); });
+    }
+}
@@ -0,0 +1,149 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "generator.hpp"
+#include "libupdate/manifest.hpp"
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point const begin) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+/**
+ * Generates a manifest in the format written by the manifester.
+ * @param count   Count of the entries.
+ * @param records Generated records, for the binary manifest.
+ * @return Text of the manifest.
+ */
+std::string generate_manifest(uint32_t const count, std::vector<libupdate::manifest_record>& records) {
+    benchmark::random random(0x616C696369610000);
+    std::string text;
+    records.reserve(count);
+    uint32_t offset = 0;
+    for (uint32_t index = 0; index < count; ++index) {
+        auto& record = records.emplace_back();
+        record.path = std::format("data/level{:03}/{:08x}/asset{}.dds", random.next() % 512,
+                                  static_cast<uint32_t>(random.next()), index);
+        record.crc = static_cast<uint32_t>(random.next());
+        record.size = static_cast<uint32_t>(random.next() % (256 * 1024));
+        record.offset = offset;
+        offset += record.size;
+
+        text += record.path;
+        text += std::format(":{:8x}\n", record.crc);
+    }
+    return text;
+}
+
+/**
+ * Parses the manifest the way libupdate did before the flat table, one character
+ * at a time into fixed buffers and a map.
+ * @param body Text of the manifest.
+ * @return Map of the paths to their crc.
+ */
+std::map<std::string, uint32_t> parse_legacy(std::string const& body) {
+    std::map<std::string, uint32_t> manifest;
+    char path[256] = {};
+    char crc[9] = {};
+    size_t offset = 0;
+
+    while (offset < body.size()) {
+        memset(path, 0, sizeof(path));
+        memset(crc, 0, sizeof(crc));
+
+        for (unsigned index = 0; index < sizeof(path); ++index, ++offset) {
+            if (offset >= body.size())
+                throw std::runtime_error("unexpected eof when parsing a path in the manifest");
+            char const c = body.at(offset);
+            if (c == ':')
+                break;
+            path[index] = c;
+        }
+        offset += 1;
+
+        for (unsigned index = 0; index < 8; ++index, ++offset) {
+            if (offset >= body.size())
+                throw std::runtime_error("unexpected eof when parsing manifest, missing crc");
+            crc[index] = body.at(offset);
+        }
+        manifest.emplace(std::string(path), static_cast<uint32_t>(std::stoll(std::string(crc), nullptr, 16)));
+        ++offset;
+    }
+    return manifest;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t const count = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 1000000;
+
+    std::vector<libupdate::manifest_record> records;
+    std::string const text = generate_manifest(count, records);
+    printf("%u entries, %.1f MiB\n", count, text.size() / (1024.0 * 1024));
+
+    auto begin = std::chrono::steady_clock::now();
+    auto const legacy = parse_legacy(text);
+    double const legacy_seconds = seconds_since(begin);
+
+    begin = std::chrono::steady_clock::now();
+    auto const manifest = libupdate::manifest::parse(text);
+    double const parse_seconds = seconds_since(begin);
+
+    std::string const binary_path = "manifest_benchmark.bin";
+    {
+        std::string const binary = libupdate::build_binary_manifest(records);
+        printf("binary manifest %.1f MiB\n", binary.size() / (1024.0 * 1024));
+        FILE* file = fopen(binary_path.c_str(), "wb");
+        fwrite(binary.data(), binary.size(), 1, file);
+        fclose(file);
+    }
+
+    begin = std::chrono::steady_clock::now();
+    auto const binary = libupdate::binary_manifest::open(binary_path);
+    double const open_seconds = seconds_since(begin);
+
+    uint64_t checksum = 0;
+    begin = std::chrono::steady_clock::now();
+    for (auto const& record : records)
+        checksum += manifest.find(record.path).value_or(0);
+    double const lookup_seconds = seconds_since(begin);
+
+    begin = std::chrono::steady_clock::now();
+    for (auto const& record : records) {
+        if (auto const* entry = binary.find(record.path))
+            checksum -= entry->crc;
+    }
+    double const binary_lookup_seconds = seconds_since(begin);
+
+    uint64_t found = 0;
+    for (auto const& record : records) {
+        auto const crc = manifest.find(record.path);
+        auto const* entry = binary.find(record.path);
+        if (crc && *crc == legacy.at(record.path) && entry && entry->crc == *crc && entry->size == record.size
+            && entry->offset == record.offset)
+            ++found;
+    }
+    std::filesystem::remove(binary_path);
+
+    printf("%-20s %10.1f ms\n", "parse (legacy)", legacy_seconds * 1000);
+    printf("%-20s %10.1f ms\n", "parse (flat)", parse_seconds * 1000);
+    printf("%-20s %10.3f ms\n", "open (binary)", open_seconds * 1000);
+    printf("%-20s %10.1f ns\n", "lookup (flat)", lookup_seconds * 1e9 / count);
+    printf("%-20s %10.1f ns (%llx)\n", "lookup (binary)", binary_lookup_seconds * 1e9 / count,
+           static_cast<unsigned long long>(checksum));
+
+    if (found != count || manifest.size() != legacy.size() || binary.size() != legacy.size()) {
+        fprintf(stderr, "the manifests disagree, %llu of %u entries match\n", static_cast<unsigned long long>(found),
+                count);
+        return 1;
+    }
+}
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "generator.hpp"
+#include "libpak/algorithms.hpp"
+#include "libpak/libpak.hpp"
+
+namespace {
+
+/**
+ * Runs the function and prints its average time and throughput.
+ * @param name       Name of the measurement.
+ * @param iterations Count of iterations.
+ * @param bytes      Bytes processed by a single iteration.
+ * @param func       Measured function.
+ */
+void measure(char const* name, int const iterations, uint64_t const bytes, std::function<void()> const& func) {
+    double total_seconds = 0;
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        auto const begin = std::chrono::steady_clock::now();
+        func();
+        auto const end = std::chrono::steady_clock::now();
+        total_seconds += std::chrono::duration<double>(end - begin).count();
+    }
+
+    double const seconds = total_seconds / iterations;
+    printf("%-28s %10.3f ms %10.1f MiB/s\n", name, seconds * 1000,
+           static_cast<double>(bytes) / seconds / (1024.0 * 1024));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    auto const options = benchmark::parse_options(argc, argv);
+
+    int iterations = 3;
+    std::string path = (std::filesystem::temp_directory_path() / "libpak-benchmark.pak").string();
+    bool keep = false;
+    bool adaptive = false;
+    for (int index = 1; index < argc; ++index) {
+        std::string_view const argument = argv[index];
+        if (argument == "--iterations" && index + 1 < argc)
+            iterations = std::atoi(argv[++index]);
+        else if (argument == "--output" && index + 1 < argc)
+            path = argv[++index];
+        else if (argument == "--keep")
+            keep = true;
+        else if (argument == "--adaptive")
+            adaptive = true;
+    }
+
+    uint64_t payload_size = 0;
+    {
+        libpak::resource resource(path);
+        payload_size = benchmark::generate_assets(resource, options);
+
+        printf("%u assets, %.1f MiB of payloads, seed %#llx\n", options.asset_count,
+               static_cast<double>(payload_size) / (1024 * 1024), static_cast<unsigned long long>(options.seed));
+
+        if (adaptive)
+            resource.compression_policy = std::make_shared<libpak::compression_policy>();
+
+        measure("write", iterations, payload_size, [&] { resource.write(); });
+
+        if (adaptive)
+            printf("%s", resource.compression_report.to_string().c_str());
+    }
+
+    uint64_t const pak_size = std::filesystem::file_size(path);
+    uint64_t const header_size = static_cast<uint64_t>(options.asset_count) * sizeof(libpak::asset_header);
+
+    measure("index read (stream)", iterations, header_size, [&] {
+        libpak::resource resource(path);
+        resource.read(false);
+    });
+    measure("index read (mapped)", iterations, header_size, [&] {
+        libpak::resource resource(path);
+        resource.resource_backend = libpak::backend::mapped;
+        resource.read(false);
+    });
+    measure("index read (compact)", iterations, header_size, [&] {
+        libpak::resource resource(path);
+        resource.read_compact();
+    });
+    measure("data read (stream)", iterations, pak_size, [&] {
+        libpak::resource resource(path);
+        resource.read(true);
+    });
+    measure("data read (mapped)", iterations, pak_size, [&] {
+        libpak::resource resource(path);
+        resource.resource_backend = libpak::backend::mapped;
+        resource.read(true);
+    });
+    measure("data read (inflate)", iterations, payload_size, [&] {
+        libpak::resource resource(path);
+        resource.decompress = true;
+        resource.read(true);
+    });
+
+    measure("data read (batch)", iterations, payload_size, [&] {
+        libpak::resource resource(path);
+        resource.decompress = true;
+        resource.read(false);
+
+        // requested in the opposite order of the data
+        std::vector<libpak::asset*> batch;
+        batch.reserve(resource.assets.size());
+        for (auto& asset : resource.assets | std::views::values)
+            batch.push_back(&asset);
+        std::ranges::sort(batch, std::ranges::greater{},
+                          [](libpak::asset const* asset) { return asset->header.embedded_data_offset; });
+        resource.read_assets(batch, [](libpak::asset&) {});
+    });
+
+    {
+        libpak::resource resource(path);
+        resource.decompress = true;
+        resource.read(true);
+
+        uint32_t combined = 0;
+        measure("checksum", iterations, payload_size, [&] {
+            combined = 0;
+            for (auto const& asset : resource.assets | std::views::values) {
+                auto const data = asset.data.bytes();
+                auto const digest = libpak::alg::crc32_checksum(reinterpret_cast<char const*>(data.data()), data.size());
+                combined ^= digest.crc ^ static_cast<uint32_t>(digest.checksum);
+            }
+        });
+        printf("digest %08x\n", combined);
+    }
+
+    if (!keep)
+        std::filesystem::remove(path);
+}
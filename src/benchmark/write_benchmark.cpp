@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <ranges>
+#include <string>
+
+#include "generator.hpp"
+#include "libpak/libpak.hpp"
+
+namespace {
+
+/**
+ * @return Count of write system calls made by the process so far.
+ */
+uint64_t write_syscalls() {
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    uint64_t value = 0;
+    while (io >> key >> value) {
+        if (key == "syscw:")
+            return value;
+    }
+    return 0;
+}
+
+/**
+ * @return Offset of the data, past the header table of the resource.
+ */
+uint64_t data_sector(const libpak::resource& resource) {
+    return std::max<uint64_t>(libpak::PAK_DATA_SECTOR, libpak::PAK_ASSET_HEADERS_SECTOR +
+                                                           resource.assets.size() * sizeof(libpak::asset_header) +
+                                                           sizeof(libpak::data_header));
+}
+
+/**
+ * Writes the resource the way libpak did before the buffered writer, seeking
+ * the output stream between the data and the header of every asset.
+ */
+void write_seeking(libpak::resource& resource) {
+    const auto output = std::make_shared<std::ofstream>(resource.resource_path, std::ios::binary);
+    libpak::stream stream(nullptr, output);
+
+    resource.content_header.assets_count = resource.assets.size();
+    stream.set_writer_cursor(libpak::PAK_CONTENT_SECTOR);
+    stream.write(resource.content_header);
+
+    auto data_offset = static_cast<int64_t>(data_sector(resource));
+    for (auto& asset : resource.assets | std::views::values) {
+        const auto header_origin = stream.set_writer_cursor(data_offset);
+        const auto encoded = libpak::resource::encode_asset_data(asset);
+        if (encoded.has_data) {
+            stream.write(reinterpret_cast<const uint8_t*>(encoded.embedded_data.data()),
+                         static_cast<int64_t>(encoded.embedded_data.size()));
+            encoded.apply(asset.header, static_cast<uint32_t>(data_offset));
+            data_offset += encoded.embedded_data.size();
+        }
+        stream.set_writer_cursor(header_origin);
+        stream.write(asset.header);
+    }
+
+    stream.write(resource.data_header);
+    stream.set_writer_cursor(0);
+    stream.write(resource.pak_header);
+    output->close();
+}
+
+/**
+ * Writes the resource with one positional write for the data and another
+ * for the header of every asset.
+ */
+void write_positional(libpak::resource& resource) {
+    const libpak::file output(resource.resource_path, libpak::file_mode::create);
+    output.write_at(resource.content_header, libpak::PAK_CONTENT_SECTOR);
+
+    uint64_t data_offset = data_sector(resource);
+    uint64_t header_offset = libpak::PAK_ASSET_HEADERS_SECTOR;
+    for (auto& asset : resource.assets | std::views::values) {
+        const auto encoded = libpak::resource::encode_asset_data(asset);
+        if (encoded.has_data) {
+            output.write_at(encoded.embedded_data.data(), encoded.embedded_data.size(), data_offset);
+            encoded.apply(asset.header, static_cast<uint32_t>(data_offset));
+            data_offset += encoded.embedded_data.size();
+        }
+        output.write_at(asset.header, header_offset);
+        header_offset += sizeof(libpak::asset_header);
+    }
+
+    output.write_at(resource.data_header, header_offset);
+    output.write_at(resource.pak_header, 0);
+}
+
+void run(const char* name, libpak::resource& resource, const int iterations,
+         const std::function<void(libpak::resource&)>& func) {
+    double total_ms = 0;
+    uint64_t syscalls = 0;
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        const uint64_t syscalls_before = write_syscalls();
+        const auto begin = std::chrono::steady_clock::now();
+        func(resource);
+        const auto end = std::chrono::steady_clock::now();
+        syscalls = write_syscalls() - syscalls_before;
+        total_ms += std::chrono::duration<double, std::milli>(end - begin).count();
+    }
+    printf("%-20s %10.3f ms %10llu write syscalls\n", name, total_ms / iterations,
+           static_cast<unsigned long long>(syscalls));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <pak> [iterations] [generator options]\n", argv[0]);
+        return 1;
+    }
+
+    const std::string path = argv[1];
+    const int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 3;
+
+    // many small assets by default, where the per-asset cost dominates
+    benchmark::generator_options options;
+    options.asset_count = 100000;
+    options.min_size = 64;
+    options.max_size = 4096;
+    options = benchmark::parse_options(argc, argv, options);
+
+    libpak::resource resource(path);
+    benchmark::generate_assets(resource, options);
+
+    run("seeking stream", resource, iterations, write_seeking);
+    run("positional", resource, iterations, write_positional);
+    run("buffered", resource, iterations, [](libpak::resource& resource) { resource.write(); });
+
+    const auto& statistics = resource.write_statistics;
+    printf("buffered writer: %llu syscalls, %llu bytes\n", static_cast<unsigned long long>(statistics.syscalls),
+           static_cast<unsigned long long>(statistics.bytes));
+}
@@ -1,29 +1,40 @@
 #include <cassert>
 #include <format>
 #include <iostream>
-#include <cuchar>
+#include <vector>
 
 #include "libpak/libpak.hpp"
+#include "libupdate/manifest.hpp"
 
 int main() {
     libpak::resource resource("res.pak");
-    resource.read(false);
+    resource.read_compact();
 
     FILE *f = fopen("res.pak.manifest", "w");
 
-    for(auto& [path, asset] : resource.assets) {
-        char buff[MB_LEN_MAX] = {};
-        mbstate_t mbstate = {};
-        // iterate over asset.header.path print it to file converting to ucode
-        for (int i = 0; ;i++) {
-            if (path[i] == 0)
-                break;
-            size_t const mb_size = c16rtomb(buff, asset.header.path[i], &mbstate);
-            fwrite(buff, mb_size, 1, f);
-        }
-
-        fprintf(f, ":%8x\n", asset.header.crc_embedded);
+    const auto& index = resource.index;
+    std::vector<libupdate::manifest_record> records;
+    records.reserve(index.size());
+    for (uint32_t entry = 0; entry < index.size(); ++entry) {
+        // duplicate paths are listed once, by the entry the resource keeps
+        if (index.has_flag(entry, libpak::compact_index::SHADOWED))
+            continue;
+
+        // write the path converted to UTF-8
+        const std::string path = libpak::path_index::to_utf8(index.path(entry));
+        fwrite(path.data(), path.size(), 1, f);
+
+        fprintf(f, ":%8x\n", index.crc_embedded(entry));
         fflush(f);
+
+        records.push_back({path, index.crc_embedded(entry), index.embedded_data_length(entry),
+                           index.embedded_data_offset(entry)});
     }
     fclose(f);
-}
\ No newline at end of file
+
+    // the binary manifest is mapped by the updater as is
+    const std::string binary = libupdate::build_binary_manifest(records);
+    FILE *b = fopen("res.pak.manifest.bin", "wb");
+    fwrite(binary.data(), binary.size(), 1, b);
+    fclose(b);
+}